@@ -7,28 +7,27 @@
 /****************************************************/
 
 #include "globals.h"
+#include "outbuf.h"
 #include "symtab.h"
 #include "analyze.h"
-
-/* counter for variable memory locations */
-static int location = 0;
+#include "source.h"
 
 /* Procedure traverse is a generic recursive 
  * syntax tree traversal routine:
  * it applies preProc in preorder and postProc 
  * in postorder to tree pointed to by t
  */
-static void traverse( TreeNode * t,
-               void (* preProc) (TreeNode *),
-               void (* postProc) (TreeNode *) )
+static void traverse( CompilerContext * ctx, TreeNode * t,
+               void (* preProc) (CompilerContext *, TreeNode *),
+               void (* postProc) (CompilerContext *, TreeNode *) )
 { if (t != NULL)
-  { preProc(t);
+  { preProc(ctx,t);
     { int i;
       for (i=0; i < MAXCHILDREN; i++)
-        traverse(t->child[i],preProc,postProc);
+        traverse(ctx,t->child[i],preProc,postProc);
     }
-    postProc(t);
-    traverse(t->sibling,preProc,postProc);
+    postProc(ctx,t);
+    traverse(ctx,t->sibling,preProc,postProc);
   }
 }
 
@@ -36,7 +35,7 @@ static void traverse( TreeNode * t,
  * generate preorder-only or postorder-only
  * traversals from traverse
  */
-static void nullProc(TreeNode * t)
+static void nullProc(CompilerContext * ctx, TreeNode * t)
 { if (t==NULL) return;
   else return;
 }
@@ -45,19 +44,19 @@ static void nullProc(TreeNode * t)
  * identifiers stored in t into 
  * the symbol table 
  */
-static void insertNode( TreeNode * t)
+static void insertNode( CompilerContext * ctx, TreeNode * t)
 { switch (t->nodekind)
   { case StmtK:
       switch (t->kind.stmt)
       { case AssignK:
         case ReadK:
-          if (st_lookup(t->attr.name) == -1)
+          if (st_lookup(ctx,t->attr.name) == -1)
           /* not yet in table, so treat as new definition */
-            st_insert(t->attr.name,t->lineno,location++);
+            st_insert(ctx,t->attr.name,lineOf(ctx->source,t->offset),ctx->location++);
           else
           /* already in table, so ignore location, 
              add line number of use only */ 
-            st_insert(t->attr.name,t->lineno,0);
+            st_insert(ctx,t->attr.name,lineOf(ctx->source,t->offset),0);
           break;
         default:
           break;
@@ -66,13 +65,13 @@ static void insertNode( TreeNode * t)
     case ExpK:
       switch (t->kind.exp)
       { case IdK:
-          if (st_lookup(t->attr.name) == -1)
+          if (st_lookup(ctx,t->attr.name) == -1)
           /* not yet in table, so treat as new definition */
-            st_insert(t->attr.name,t->lineno,location++);
+            st_insert(ctx,t->attr.name,lineOf(ctx->source,t->offset),ctx->location++);
           else
           /* already in table, so ignore location, 
              add line number of use only */ 
-            st_insert(t->attr.name,t->lineno,0);
+            st_insert(ctx,t->attr.name,lineOf(ctx->source,t->offset),0);
           break;
         default:
           break;
@@ -86,30 +85,30 @@ static void insertNode( TreeNode * t)
 /* Function buildSymtab constructs the symbol 
  * table by preorder traversal of the syntax tree
  */
-void buildSymtab(TreeNode * syntaxTree)
-{ traverse(syntaxTree,insertNode,nullProc);
-  if (TraceAnalyze)
-  { fprintf(listing,"\nSymbol table:\n\n");
-    printSymTab(listing);
+void buildSymtab(CompilerContext * ctx, TreeNode * syntaxTree)
+{ traverse(ctx,syntaxTree,insertNode,nullProc);
+  if (ctx->TraceAnalyze)
+  { outPrintf(ctx->listing,"\nSymbol table:\n\n");
+    printSymTab(ctx);
   }
 }
 
-static void typeError(TreeNode * t, char * message)
-{ fprintf(listing,"Type error at line %d: %s\n",t->lineno,message);
-  Error = TRUE;
+static void typeError(CompilerContext * ctx, TreeNode * t, char * message)
+{ outPrintf(ctx->listing,"Type error at line %d: %s\n",lineOf(ctx->source,t->offset),message);
+  ctx->Error = TRUE;
 }
 
 /* Procedure checkNode performs
  * type checking at a single tree node
  */
-static void checkNode(TreeNode * t)
+static void checkNode(CompilerContext * ctx, TreeNode * t)
 { switch (t->nodekind)
   { case ExpK:
       switch (t->kind.exp)
       { case OpK:
           if ((t->child[0]->type != Integer) ||
               (t->child[1]->type != Integer))
-            typeError(t,"Op applied to non-integer");
+            typeError(ctx,t,"Op applied to non-integer");
           if ((t->attr.op == EQ) || (t->attr.op == LT))
             t->type = Boolean;
           else
@@ -127,19 +126,19 @@ static void checkNode(TreeNode * t)
       switch (t->kind.stmt)
       { case IfK:
           if (t->child[0]->type == Integer)
-            typeError(t->child[0],"if test is not Boolean");
+            typeError(ctx,t->child[0],"if test is not Boolean");
           break;
         case AssignK:
           if (t->child[0]->type != Integer)
-            typeError(t->child[0],"assignment of non-integer value");
+            typeError(ctx,t->child[0],"assignment of non-integer value");
           break;
         case WriteK:
           if (t->child[0]->type != Integer)
-            typeError(t->child[0],"write of non-integer value");
+            typeError(ctx,t->child[0],"write of non-integer value");
           break;
         case RepeatK:
           if (t->child[1]->type == Integer)
-            typeError(t->child[1],"repeat test is not Boolean");
+            typeError(ctx,t->child[1],"repeat test is not Boolean");
           break;
         default:
           break;
@@ -154,6 +153,6 @@ static void checkNode(TreeNode * t)
 /* Procedure typeCheck performs type checking 
  * by a postorder syntax tree traversal
  */
-void typeCheck(TreeNode * syntaxTree)
-{ traverse(syntaxTree,nullProc,checkNode);
+void typeCheck(CompilerContext * ctx, TreeNode * syntaxTree)
+{ traverse(ctx,syntaxTree,nullProc,checkNode);
 }
@@ -0,0 +1,133 @@
+/****************************************************/
+/* File: arena.c                                    */
+/* Per-compilation bump allocator for the syntax    */
+/* tree: released all at once by arenaReset         */
+/****************************************************/
+
+#include "globals.h"
+#include "arena.h"
+
+/* chunks start on a cache line; CHUNKHEADER keeps
+ * their data on one too
+ */
+#define CACHELINE 64
+#define CHUNKHEADER CACHELINE
+
+/* the first chunk has MINCHUNK bytes; each new one
+ * doubles the last, up to MAXCHUNK
+ */
+#define MINCHUNK (64 * 1024)
+#define MAXCHUNK (4 * 1024 * 1024)
+
+/* allocations are rounded up to ALIGN bytes */
+#define ALIGN 16
+
+typedef struct arenaChunk
+{
+  struct arenaChunk *next;
+  size_t size; /* bytes of data */
+} ArenaChunk;
+
+#define CHUNKDATA(c) ((char *)(c) + CHUNKHEADER)
+
+typedef struct arena
+{
+  ArenaChunk *first;
+  ArenaChunk *cur; /* the chunk allocations come from */
+  char *next;      /* its first free byte */
+  char *end;       /* its end */
+} Arena;
+
+/* make c the current chunk */
+static void useChunk(Arena *a, ArenaChunk *c)
+{
+  a->cur = c;
+  a->next = CHUNKDATA(c);
+  a->end = CHUNKDATA(c) + c->size;
+}
+
+/* move on to a chunk with room for size bytes:
+ * the next kept chunk if it is large enough, else
+ * a new one after the current chunk
+ */
+static int grow(CompilerContext *ctx, size_t size)
+{
+  Arena *a = ctx->arena;
+  ArenaChunk *c;
+  size_t csize;
+  void *p;
+
+  if (a == NULL)
+  {
+    a = (Arena *)calloc(1, sizeof(Arena));
+    if (a == NULL)
+      return FALSE;
+    ctx->arena = a;
+  }
+  if (a->cur != NULL && a->cur->next != NULL && a->cur->next->size >= size)
+  {
+    useChunk(a, a->cur->next);
+    return TRUE;
+  }
+  csize = a->cur == NULL ? MINCHUNK : a->cur->size * 2;
+  if (csize > MAXCHUNK)
+    csize = MAXCHUNK;
+  if (csize < size)
+    csize = size;
+  if (posix_memalign(&p, CACHELINE, CHUNKHEADER + csize) != 0)
+    return FALSE;
+  c = (ArenaChunk *)p;
+  c->size = csize;
+  if (a->cur == NULL)
+  {
+    c->next = a->first;
+    a->first = c;
+  }
+  else
+  {
+    c->next = a->cur->next;
+    a->cur->next = c;
+  }
+  useChunk(a, c);
+  return TRUE;
+}
+
+void *arenaAlloc(CompilerContext *ctx, size_t size, AllocSite site, int kind)
+{
+  Arena *a = ctx->arena;
+  char *p;
+
+  countAlloc(ctx, size, site, kind);
+  size = (size + ALIGN - 1) & ~(size_t)(ALIGN - 1);
+  if (a == NULL || (size_t)(a->end - a->next) < size)
+  {
+    if (!grow(ctx, size))
+      return NULL;
+    a = ctx->arena;
+  }
+  p = a->next;
+  a->next += size;
+  return p;
+}
+
+void arenaReset(CompilerContext *ctx)
+{
+  Arena *a = ctx->arena;
+  if (a != NULL && a->first != NULL)
+    useChunk(a, a->first);
+}
+
+void arenaFree(CompilerContext *ctx)
+{
+  Arena *a = ctx->arena;
+  if (a == NULL)
+    return;
+  while (a->first != NULL)
+  {
+    ArenaChunk *next = a->first->next;
+    free(a->first);
+    a->first = next;
+  }
+  free(a);
+  ctx->arena = NULL;
+}
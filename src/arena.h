@@ -0,0 +1,32 @@
+/****************************************************/
+/* File: arena.h                                    */
+/* Per-compilation bump allocator for the syntax    */
+/* tree: released all at once by arenaReset         */
+/****************************************************/
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include "memstat.h"
+
+/* Function arenaAlloc allocates size bytes for
+ * site from the arena of ctx, counting them as
+ * countedAlloc does. The memory is 16-byte aligned
+ * and lives until the next arenaReset of ctx; it
+ * must not be passed to free(). Returns NULL if out
+ * of memory.
+ */
+void *arenaAlloc(CompilerContext *ctx, size_t size, AllocSite site, int kind);
+
+/* Procedure arenaReset releases everything
+ * allocated from the arena of ctx in O(1); its
+ * chunks are kept for the next compilation
+ */
+void arenaReset(CompilerContext *ctx);
+
+/* Procedure arenaFree returns the chunks of the
+ * arena of ctx to the system
+ */
+void arenaFree(CompilerContext *ctx);
+
+#endif
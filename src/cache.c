@@ -0,0 +1,374 @@
+/****************************************************/
+/* File: cache.c                                    */
+/* Content-addressed compilation cache              */
+/****************************************************/
+
+#include "globals.h"
+#include "cache.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+/* bump CACHE_VERSION whenever the listing or code
+ * format changes, so stale entries stop matching
+ */
+#define CACHE_VERSION 1
+#define CACHE_MAGIC 0x31454343 /* "CCE1" */
+#define CACHE_SUFFIX ".cce"
+#define CACHE_STATS "stats"
+
+/* header of an entry file; the listing and the
+ * code follow it
+ */
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t error;
+   uint32_t pad;
+   uint64_t listingLen;
+   uint64_t codeLen;
+} CacheEntry;
+
+/* one file of the directory, for eviction */
+typedef struct
+{
+   char name[CACHE_KEYLEN + sizeof(CACHE_SUFFIX)];
+   size_t size;
+   struct timespec mtime;
+} CacheFile;
+
+static uint64_t rotl(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t fmix(uint64_t x)
+{
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+/* feed len bytes into the two hash lanes h, eight bytes at a time */
+static void hashBytes(uint64_t h[2], const char *p, size_t len)
+{
+  uint64_t w;
+  while (len >= 8)
+  {
+    memcpy(&w, p, 8);
+    h[0] = rotl(h[0] ^ (w * 0x87c37b91114253d5ULL), 31) * 0x4cf5ad432745937fULL;
+    h[1] = rotl(h[1] + (w * 0x4cf5ad432745937fULL), 27) * 0x87c37b91114253d5ULL;
+    p += 8;
+    len -= 8;
+  }
+  w = 0;
+  memcpy(&w, p, len);
+  w ^= (uint64_t)len << 56;
+  h[0] = rotl(h[0] ^ (w * 0x87c37b91114253d5ULL), 31) * 0x4cf5ad432745937fULL;
+  h[1] = rotl(h[1] + (w * 0x4cf5ad432745937fULL), 27) * 0x87c37b91114253d5ULL;
+}
+
+void cacheKey(CacheKey key, const char *src, size_t len, const char *name,
+              unsigned flags)
+{
+  uint64_t h[2], mode[2];
+
+  h[0] = 0x9e3779b97f4a7c15ULL ^ len;
+  h[1] = 0x6a09e667f3bcc909ULL ^ len;
+  hashBytes(h, src, len);
+  /* the name is printed in the listing header */
+  hashBytes(h, name, strlen(name));
+  mode[0] = flags;
+  mode[1] = CACHE_VERSION;
+  hashBytes(h, (const char *)mode, sizeof(mode));
+  h[0] += h[1];
+  h[1] += h[0];
+  snprintf(key, CACHE_KEYLEN + 1, "%016llx%016llx",
+           (unsigned long long)fmix(h[0]), (unsigned long long)fmix(h[1]));
+}
+
+/* path of the file name in the cache directory */
+static char *cachePath(CompileCache *cache, const char *name, char *path,
+                       size_t size)
+{
+  snprintf(path, size, "%s/%s", cache->dir, name);
+  return path;
+}
+
+static int byMtime(const void *a, const void *b)
+{
+  const CacheFile *x = (const CacheFile *)a, *y = (const CacheFile *)b;
+  if (x->mtime.tv_sec != y->mtime.tv_sec)
+    return x->mtime.tv_sec < y->mtime.tv_sec ? -1 : 1;
+  return (x->mtime.tv_nsec > y->mtime.tv_nsec) -
+         (x->mtime.tv_nsec < y->mtime.tv_nsec);
+}
+
+/* recount the entries of the directory and, if they
+ * exceed the size bound, remove the least recently
+ * used ones. cache->lock must be held.
+ */
+static void cacheScan(CompileCache *cache)
+{
+  CacheFile *files = NULL;
+  int nfiles = 0, maxfiles = 0, i;
+  size_t total = 0;
+  char path[4096];
+  struct dirent *d;
+  struct stat st;
+  DIR *dir = opendir(cache->dir);
+
+  if (dir == NULL)
+    return;
+  while ((d = readdir(dir)) != NULL)
+  {
+    size_t n = strlen(d->d_name);
+    if (n != CACHE_KEYLEN + strlen(CACHE_SUFFIX) ||
+        strcmp(d->d_name + CACHE_KEYLEN, CACHE_SUFFIX) != 0)
+      continue;
+    if (stat(cachePath(cache, d->d_name, path, sizeof(path)), &st) < 0)
+      continue;
+    if (nfiles == maxfiles)
+    {
+      CacheFile *f;
+      maxfiles = maxfiles ? maxfiles * 2 : 256;
+      f = (CacheFile *)realloc(files, maxfiles * sizeof(CacheFile));
+      if (f == NULL)
+        break;
+      files = f;
+    }
+    strcpy(files[nfiles].name, d->d_name);
+    files[nfiles].size = st.st_size;
+    files[nfiles].mtime = st.st_mtim;
+    total += st.st_size;
+    nfiles++;
+  }
+  closedir(dir);
+
+  if (total > cache->maxSize)
+  {
+    qsort(files, nfiles, sizeof(CacheFile), byMtime);
+    for (i = 0; i < nfiles && total > cache->maxSize / 4 * 3; i++)
+    {
+      if (unlink(cachePath(cache, files[i].name, path, sizeof(path))) == 0)
+        cache->evictions++;
+      total -= files[i].size;
+    }
+  }
+  cache->curSize = total;
+  free(files);
+}
+
+int cacheOpen(CompileCache *cache, const char *dir, size_t maxSize)
+{
+  struct stat st;
+
+  memset(cache, 0, sizeof(CompileCache));
+  if (mkdir(dir, 0777) < 0 && errno != EEXIST)
+    return FALSE;
+  if (stat(dir, &st) < 0 || !S_ISDIR(st.st_mode))
+    return FALSE;
+  cache->dir = strdup(dir);
+  cache->maxSize = maxSize;
+  pthread_mutex_init(&cache->lock, NULL);
+  pthread_mutex_lock(&cache->lock);
+  cacheScan(cache);
+  pthread_mutex_unlock(&cache->lock);
+  return TRUE;
+}
+
+/* read len bytes of fd into a new NUL terminated buffer */
+static char *readPart(int fd, size_t len)
+{
+  char *buf = (char *)malloc(len + 1);
+  size_t done = 0;
+  if (buf == NULL)
+    return NULL;
+  while (done < len)
+  {
+    ssize_t n = read(fd, buf + done, len - done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+    {
+      free(buf);
+      return NULL;
+    }
+    done += n;
+  }
+  buf[len] = '\0';
+  return buf;
+}
+
+int cacheLookup(CompileCache *cache, const CacheKey key, CminusResult *result)
+{
+  char name[CACHE_KEYLEN + sizeof(CACHE_SUFFIX)], path[4096];
+  CacheEntry e;
+  struct stat st;
+  int fd, hit = FALSE;
+
+  memset(result, 0, sizeof(CminusResult));
+  snprintf(name, sizeof(name), "%s%s", key, CACHE_SUFFIX);
+  fd = open(cachePath(cache, name, path, sizeof(path)), O_RDONLY);
+  if (fd >= 0)
+  {
+    if (fstat(fd, &st) == 0 && read(fd, &e, sizeof(e)) == sizeof(e) &&
+        e.magic == CACHE_MAGIC && e.version == CACHE_VERSION &&
+        (uint64_t)st.st_size == sizeof(e) + e.listingLen + e.codeLen)
+    {
+      result->listing = readPart(fd, e.listingLen);
+      result->code = readPart(fd, e.codeLen);
+      result->listingLen = e.listingLen;
+      result->codeLen = e.codeLen;
+      result->error = e.error;
+      hit = result->listing != NULL && result->code != NULL;
+      if (!hit)
+        cminusFreeResult(result);
+      else /* mark as recently used */
+        futimens(fd, NULL);
+    }
+    close(fd);
+  }
+
+  pthread_mutex_lock(&cache->lock);
+  if (hit)
+    cache->hits++;
+  else
+    cache->misses++;
+  pthread_mutex_unlock(&cache->lock);
+  return hit;
+}
+
+void cacheStore(CompileCache *cache, const CacheKey key,
+                const CminusResult *result)
+{
+  static int tmpCount = 0;
+  char name[CACHE_KEYLEN + sizeof(CACHE_SUFFIX)], path[4096], tmp[4096];
+  CacheEntry e;
+  FILE *f;
+  int n, ok;
+
+  pthread_mutex_lock(&cache->lock);
+  n = tmpCount++;
+  pthread_mutex_unlock(&cache->lock);
+
+  /* write to a private name and rename it into place,
+   * so readers never see a partial entry
+   */
+  snprintf(name, sizeof(name), "tmp.%ld.%d", (long)getpid(), n);
+  cachePath(cache, name, tmp, sizeof(tmp));
+  f = fopen(tmp, "wb");
+  if (f == NULL)
+    return;
+  memset(&e, 0, sizeof(e));
+  e.magic = CACHE_MAGIC;
+  e.version = CACHE_VERSION;
+  e.error = result->error;
+  e.listingLen = result->listingLen;
+  e.codeLen = result->codeLen;
+  ok = fwrite(&e, sizeof(e), 1, f) == 1 &&
+       fwrite(result->listing, 1, result->listingLen, f) == result->listingLen &&
+       fwrite(result->code, 1, result->codeLen, f) == result->codeLen;
+  ok = fclose(f) == 0 && ok;
+  snprintf(name, sizeof(name), "%s%s", key, CACHE_SUFFIX);
+  if (!ok || rename(tmp, cachePath(cache, name, path, sizeof(path))) < 0)
+  {
+    unlink(tmp);
+    return;
+  }
+
+  pthread_mutex_lock(&cache->lock);
+  cache->stores++;
+  cache->curSize += sizeof(e) + result->listingLen + result->codeLen;
+  if (cache->curSize > cache->maxSize)
+    cacheScan(cache);
+  pthread_mutex_unlock(&cache->lock);
+}
+
+/* the counters kept in the stats file, in file order */
+static const char *statNames[] = {"hits", "misses", "stores", "evictions"};
+#define NSTATS 4
+
+/* read the totals of the stats file open on fd */
+static void readStats(int fd, long totals[NSTATS])
+{
+  char buf[256], word[32];
+  ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+  char *p = buf;
+  long value;
+  int i, used;
+
+  memset(totals, 0, NSTATS * sizeof(long));
+  if (n <= 0)
+    return;
+  buf[n] = '\0';
+  while (sscanf(p, "%31s %ld%n", word, &value, &used) == 2)
+  {
+    for (i = 0; i < NSTATS; i++)
+      if (strcmp(word, statNames[i]) == 0)
+        totals[i] = value;
+    p += used;
+  }
+}
+
+void cachePrintStats(CompileCache *cache, FILE *out)
+{
+  long totals[NSTATS];
+  char path[4096];
+  int fd = open(cachePath(cache, CACHE_STATS, path, sizeof(path)), O_RDONLY);
+
+  memset(totals, 0, sizeof(totals));
+  if (fd >= 0)
+  {
+    flock(fd, LOCK_SH);
+    readStats(fd, totals);
+    close(fd);
+  }
+  pthread_mutex_lock(&cache->lock);
+  fprintf(out, "cache: %ld hits, %ld misses, %ld stores, %ld evictions; "
+               "%.1f%% hit rate, %zu of %zu bytes used in %s\n",
+          cache->hits, cache->misses, cache->stores, cache->evictions,
+          cache->hits + cache->misses
+              ? 100.0 * cache->hits / (cache->hits + cache->misses)
+              : 0.0,
+          cache->curSize, cache->maxSize, cache->dir);
+  fprintf(out, "cache totals: %ld hits, %ld misses, %ld stores, %ld evictions\n",
+          totals[0] + cache->hits, totals[1] + cache->misses,
+          totals[2] + cache->stores, totals[3] + cache->evictions);
+  pthread_mutex_unlock(&cache->lock);
+}
+
+void cacheClose(CompileCache *cache)
+{
+  long totals[NSTATS];
+  char path[4096], buf[256];
+  int fd, n;
+
+  fd = open(cachePath(cache, CACHE_STATS, path, sizeof(path)),
+            O_RDWR | O_CREAT, 0666);
+  if (fd >= 0)
+  {
+    /* other processes may share the directory */
+    flock(fd, LOCK_EX);
+    readStats(fd, totals);
+    n = snprintf(buf, sizeof(buf), "%s %ld\n%s %ld\n%s %ld\n%s %ld\n",
+                 statNames[0], totals[0] + cache->hits,
+                 statNames[1], totals[1] + cache->misses,
+                 statNames[2], totals[2] + cache->stores,
+                 statNames[3], totals[3] + cache->evictions);
+    if (ftruncate(fd, 0) == 0 && pwrite(fd, buf, n, 0) != n)
+      fprintf(stderr, "cannot update %s\n", path);
+    close(fd);
+  }
+  pthread_mutex_destroy(&cache->lock);
+  free(cache->dir);
+  cache->dir = NULL;
+}
@@ -0,0 +1,69 @@
+/****************************************************/
+/* File: cache.h                                    */
+/* Content-addressed compilation cache: listings    */
+/* and TM code stored on disk under a hash of the   */
+/* source bytes and the compiler mode flags         */
+/****************************************************/
+
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <pthread.h>
+#include "cminus.h"
+
+/* default size bound of a cache directory */
+#define CACHE_DEFAULT_SIZE (64 * 1024 * 1024)
+
+/* a cache key: 128-bit hash as hex */
+#define CACHE_KEYLEN 32
+typedef char CacheKey[CACHE_KEYLEN + 1];
+
+/* An open cache directory. The counters cover the
+ * lifetime of this process; cacheClose adds them to
+ * the totals kept in the directory.
+ */
+typedef struct
+{
+   char *dir;
+   size_t maxSize;   /* evict down to 3/4 of this when exceeded */
+   size_t curSize;   /* bytes of entries, as of the last scan */
+   long hits, misses, stores, evictions;
+   pthread_mutex_t lock;
+} CompileCache;
+
+/* Function cacheOpen opens (creating it if needed)
+ * the cache directory dir, bounded to maxSize bytes.
+ * Returns FALSE if dir cannot be used.
+ */
+int cacheOpen(CompileCache *cache, const char *dir, size_t maxSize);
+
+/* Procedure cacheKey computes the key of compiling
+ * the len bytes at src, named name, with the mode
+ * flags returned by compileFlags()
+ */
+void cacheKey(CacheKey key, const char *src, size_t len, const char *name,
+              unsigned flags);
+
+/* Function cacheLookup fills result with the entry
+ * stored under key. Returns FALSE on a miss.
+ */
+int cacheLookup(CompileCache *cache, const CacheKey key, CminusResult *result);
+
+/* Procedure cacheStore stores result under key,
+ * evicting the least recently used entries if the
+ * cache grows past its size bound
+ */
+void cacheStore(CompileCache *cache, const CacheKey key,
+                const CminusResult *result);
+
+/* Procedure cachePrintStats prints the counters of
+ * this process and the totals of the directory
+ */
+void cachePrintStats(CompileCache *cache, FILE *out);
+
+/* Procedure cacheClose records the counters of this
+ * process in the directory and releases cache
+ */
+void cacheClose(CompileCache *cache);
+
+#endif
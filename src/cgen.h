@@ -14,6 +14,6 @@
  * of the code file, and is used to print the
  * file name as a comment in the code file
  */
-void codeGen(TreeNode * syntaxTree, char * codefile);
+void codeGen(CompilerContext * ctx, TreeNode * syntaxTree, char * codefile);
 
 #endif
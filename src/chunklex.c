@@ -0,0 +1,351 @@
+/****************************************************/
+/* File: chunklex.c                                 */
+/* Parallel lexing (--lex-threads): the source is   */
+/* split into chunks that are scanned concurrently  */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "timing.h"
+#include "chunklex.h"
+#include "simd.h"
+#include <pthread.h>
+
+/* MINCHUNK is the smallest chunk worth a thread */
+#ifndef MINCHUNK
+#define MINCHUNK (256 * 1024)
+#endif
+
+/* MAXCHUNKS is the maximum number of threads */
+#define MAXCHUNKS 64
+
+/* The only context of the C- scanner is being in a
+ * comment or not: no token contains "/" except the
+ * one-byte OVER. So the scanner state at any byte
+ * is found by this automaton over '/' and '*'.
+ */
+typedef enum
+{
+  Out,      /* between or inside tokens */
+  OutSlash, /* just after a '/' that may open a comment */
+  In,       /* in a comment */
+  InStar,   /* in a comment, just after a '*' */
+  NSTATES
+} CommentState;
+
+/* input classes of the automaton */
+enum { Other, Slash, Star };
+
+static const unsigned char next[NSTATES][3] = {
+  /* Other  Slash     Star  */
+  {Out,    OutSlash, Out},    /* Out */
+  {Out,    OutSlash, In},     /* OutSlash */
+  {In,     In,       InStar}, /* In */
+  {In,     Out,      InStar}, /* InStar */
+};
+
+/* the tokens of one chunk, in order */
+typedef struct
+{
+  TokenSpan *tok;
+  size_t ntok, maxtok;
+} Chunk;
+
+typedef struct tokenChunks
+{
+  Chunk chunk[MAXCHUNKS];
+  int nchunks;
+  int cur;     /* chunk of the next token */
+  size_t pos;  /* index of the next token in it */
+} TokenChunks;
+
+/* what a lexing thread needs */
+typedef struct
+{
+  const char *text;
+  size_t len;
+  ScanEngine engine;             /* the scanner of every chunk */
+  int nchunks;
+  int k;                         /* this thread's chunk */
+  unsigned char (*map)[NSTATES]; /* of every chunk */
+  Chunk *chunk;
+  int ok;
+} Worker;
+
+/* the first '/' or '*' in p..end, or end */
+static const char *nextSpecial(const char *p, const char *end)
+{
+#ifdef VLEN
+  while (end - p >= VLEN)
+  {
+    Vec v = vload(p);
+    Mask m = vmask(vor(veq(v, vset('/')), veq(v, vset('*'))));
+    if (m)
+      return p + __builtin_ctz(m);
+    p += VLEN;
+  }
+#endif
+  while (p < end && *p != '/' && *p != '*')
+    p++;
+  return p;
+}
+
+/* set map[s] to the state at end when p is in state
+ * s, for all states at once
+ */
+static void chunkMap(const char *p, const char *end, unsigned char map[NSTATES])
+{
+  const char *q;
+  int s;
+  for (s = 0; s < NSTATES; s++)
+    map[s] = s;
+  while ((q = nextSpecial(p, end)) < end)
+  {
+    int c = *q == '/' ? Slash : Star;
+    for (s = 0; s < NSTATES; s++)
+      map[s] = next[q > p ? next[map[s]][Other] : map[s]][c];
+    p = q + 1;
+  }
+  if (p < end)
+    for (s = 0; s < NSTATES; s++)
+      map[s] = next[map[s]][Other];
+}
+
+/* Function syncPoint returns the first offset at or
+ * after at where the scanners are between tokens
+ * and outside comments, given the state there: just
+ * past a '\n' that is not in a comment. Returns len
+ * if there is none.
+ */
+static size_t syncPoint(const char *text, size_t len, size_t at, int state)
+{
+  const char *p = text + at, *end = text + len;
+  while (p < end)
+  {
+    if (state == In)
+    { /* skip to the next '*' of the comment */
+      p = memchr(p, '*', end - p);
+      if (p == NULL)
+        return len;
+    }
+    if (*p == '\n' && (state == Out || state == OutSlash))
+      return p + 1 - text;
+    state = next[state][*p == '/' ? Slash : *p == '*' ? Star : Other];
+    p++;
+  }
+  return len;
+}
+
+/* the nominal bounds of chunk k */
+#define CHUNKLO(w, k) ((w)->len * (k) / (w)->nchunks)
+
+/* the offset where chunk k's tokens begin */
+static size_t chunkStart(Worker *w, int k)
+{
+  int state = Out, i;
+  if (k == 0)
+    return 0;
+  if (k == w->nchunks)
+    return w->len;
+  for (i = 0; i < k; i++)
+    state = w->map[i][state];
+  return syncPoint(w->text, w->len, CHUNKLO(w, k), state);
+}
+
+/* append t to c */
+static int addToken(Chunk *c, const TokenSpan *t)
+{
+  if (c->ntok == c->maxtok)
+  {
+    size_t max = c->maxtok ? c->maxtok * 2 : 4096;
+    TokenSpan *p = (TokenSpan *)realloc(c->tok, max * sizeof(TokenSpan));
+    if (p == NULL)
+      return FALSE;
+    c->tok = p;
+    c->maxtok = max;
+  }
+  c->tok[c->ntok++] = *t;
+  return TRUE;
+}
+
+/* phase 1: how chunk k maps comment states */
+static void *mapWorker(void *arg)
+{
+  Worker *w = (Worker *)arg;
+  chunkMap(w->text + CHUNKLO(w, w->k), w->text + CHUNKLO(w, w->k + 1), w->map[w->k]);
+  return NULL;
+}
+
+/* scan text[lo..hi) with the direct engine */
+static int directChunk(Worker *w, size_t lo, size_t hi)
+{
+  const char *pos = w->text + lo;
+  TokenSpan tok;
+  for (;;)
+  {
+    TokenType t = scanBytes(w->text, w->text + hi, &pos, FALSE, &tok);
+    if (t == ENDFILE && hi < w->len)
+      return TRUE;
+    if (!addToken(w->chunk, &tok))
+      return FALSE;
+    if (t == ENDFILE)
+      return TRUE;
+  }
+}
+
+/* scan text[lo..hi) with the flex engine. flex
+ * writes into the buffer it scans and needs two NUL
+ * bytes after it, so the chunk is scanned in a copy
+ * of its own, by a scanner of its own.
+ */
+static int flexChunk(Worker *w, size_t lo, size_t hi)
+{
+  CompilerContext context, *ctx = &context;
+  SourceBuffer sb;
+  int ok = TRUE;
+
+  memset(&sb, 0, sizeof(SourceBuffer));
+  sb.len = hi - lo;
+  sb.size = sb.len + 2;
+  sb.text = (char *)malloc(sb.size);
+  if (sb.text == NULL)
+    return FALSE;
+  memcpy(sb.text, w->text + lo, sb.len);
+  sb.text[sb.len] = sb.text[sb.len + 1] = '\0';
+  initContext(ctx);
+  ctx->scanEngine = ScanFlex;
+  ctx->source = &sb;
+  flexInit(ctx);
+  for (;;)
+  {
+    TokenType t = flexToken(ctx);
+    if (t == ENDFILE && hi < w->len)
+      break;
+    ctx->tok.offset += lo;
+    if (!addToken(w->chunk, &ctx->tok))
+    {
+      ok = FALSE;
+      break;
+    }
+    if (t == ENDFILE)
+      break;
+  }
+  freeContext(ctx);
+  free(sb.text);
+  return ok;
+}
+
+/* phase 2: scan the tokens between chunk k's sync
+ * point and the next one with the engine of the
+ * compilation; only the last chunk keeps ENDFILE
+ */
+static void *lexWorker(void *arg)
+{
+  Worker *w = (Worker *)arg;
+  size_t lo = chunkStart(w, w->k), hi = chunkStart(w, w->k + 1);
+  if (lo > hi)
+    lo = hi;
+  w->ok = w->engine == ScanFlex ? flexChunk(w, lo, hi) : directChunk(w, lo, hi);
+  return NULL;
+}
+
+/* run fn on every worker, worker 0 on the calling
+ * thread; a worker whose thread cannot be created
+ * runs on the calling thread as well
+ */
+static void runWorkers(void *(*fn)(void *), Worker *worker, int n)
+{
+  pthread_t thread[MAXCHUNKS];
+  int started[MAXCHUNKS];
+  int i;
+  for (i = 1; i < n; i++)
+    started[i] = pthread_create(&thread[i], NULL, fn, &worker[i]) == 0;
+  fn(&worker[0]);
+  for (i = 1; i < n; i++)
+    if (started[i])
+      pthread_join(thread[i], NULL);
+    else
+      fn(&worker[i]);
+}
+
+int chunkLex(CompilerContext *ctx, int nthreads)
+{
+  size_t len = ctx->source->len;
+  size_t n = len / MINCHUNK;
+  unsigned char map[MAXCHUNKS][NSTATES];
+  Worker worker[MAXCHUNKS];
+  TokenChunks *tc;
+  double wall, cpu;
+  int i, ok = TRUE;
+
+  if (n > (size_t)nthreads)
+    n = nthreads;
+  if (n > MAXCHUNKS)
+    n = MAXCHUNKS;
+  if (n < 2)
+    return FALSE;
+  tc = (TokenChunks *)calloc(1, sizeof(TokenChunks));
+  if (tc == NULL)
+    return FALSE;
+  wall = wallClock();
+  cpu = cpuClock();
+  spanBegin(ctx, "lex");
+  for (i = 0; i < (int)n; i++)
+  {
+    worker[i].text = ctx->source->text;
+    worker[i].len = len;
+    worker[i].engine = ctx->scanEngine;
+    worker[i].nchunks = n;
+    worker[i].k = i;
+    worker[i].map = map;
+    worker[i].chunk = &tc->chunk[i];
+  }
+  runWorkers(mapWorker, worker, n);
+  runWorkers(lexWorker, worker, n);
+  spanEnd(ctx, NULL);
+  if (ctx->timing != NULL)
+  { /* all the scan time there is: getToken just reads the chunks */
+    ctx->timing->lexWall += wallClock() - wall;
+    ctx->timing->lexCpu += cpuClock() - cpu;
+  }
+  for (i = 0; i < (int)n; i++)
+    ok = ok && worker[i].ok;
+  tc->nchunks = n;
+  ctx->chunks = tc;
+  if (!ok)
+    chunkFree(ctx);
+  return ok;
+}
+
+TokenType chunkToken(CompilerContext *ctx)
+{
+  TokenChunks *tc = ctx->chunks;
+  for (;;)
+  {
+    Chunk *c = &tc->chunk[tc->cur];
+    if (tc->pos == c->ntok)
+    {
+      /* the last chunk ends with ENDFILE: repeat it */
+      if (tc->cur + 1 == tc->nchunks)
+        return ctx->tok.kind = ENDFILE;
+      tc->cur++;
+      tc->pos = 0;
+      continue;
+    }
+    ctx->tok = c->tok[tc->pos++];
+    if (ctx->tok.kind != COMMENT || !ctx->skipComments)
+      return ctx->tok.kind;
+  }
+}
+
+void chunkFree(CompilerContext *ctx)
+{
+  int i;
+  if (ctx->chunks == NULL)
+    return;
+  for (i = 0; i < MAXCHUNKS; i++)
+    free(ctx->chunks->chunk[i].tok);
+  free(ctx->chunks);
+  ctx->chunks = NULL;
+}
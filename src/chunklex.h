@@ -0,0 +1,29 @@
+/****************************************************/
+/* File: chunklex.h                                 */
+/* Parallel lexing (--lex-threads): the source is   */
+/* split into chunks that are scanned concurrently  */
+/****************************************************/
+
+#ifndef _CHUNKLEX_H_
+#define _CHUNKLEX_H_
+
+/* Function chunkLex scans all of ctx->source on up
+ * to nthreads threads into ctx->chunks, each chunk
+ * with the engine of ctx->scanEngine, giving the
+ * token stream of that engine run sequentially
+ * (checked by lexcheck.c). Returns
+ * FALSE (and leaves ctx->chunks NULL) if the source
+ * is too small to split or a thread cannot start.
+ */
+int chunkLex(CompilerContext *ctx, int nthreads);
+
+/* Function chunkToken takes the next token of
+ * ctx->chunks into ctx->tok. COMMENT tokens are
+ * dropped if ctx->skipComments.
+ */
+TokenType chunkToken(CompilerContext *ctx);
+
+/* Procedure chunkFree releases ctx->chunks */
+void chunkFree(CompilerContext *ctx);
+
+#endif
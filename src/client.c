@@ -0,0 +1,174 @@
+/****************************************************/
+/* File: client.c                                   */
+/* hw2_client: compiles C- files on a running       */
+/* compile server (hw2_binary --server)             */
+/****************************************************/
+
+#include "globals.h"
+#include "server.h"
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define RESULT_FILE_LIST "result_file_list.txt"
+#define FILE_OUT_SUFFIX "_20161250.txt"
+
+/* connect to the server at path; returns -1 on failure */
+static int connectServer(const char *path)
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  if (strlen(path) >= sizeof(addr.sun_path))
+    return -1;
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/* write len bytes of data to the file fname */
+static int writeFile(const char *fname, const char *data, size_t len)
+{
+  FILE *f = fopen(fname, "w");
+  if (f == NULL)
+  {
+    fprintf(stderr, "fopen(%s) failed.\n", fname);
+    return FALSE;
+  }
+  fwrite(data, 1, len, f);
+  fclose(f);
+  return TRUE;
+}
+
+/* have the server compile filename and write its listing
+ * to <pgm>_20161250.txt and its code to <pgm>.tm.
+ * returns FALSE if the file could not be compiled.
+ */
+static int compileRemote(int fd, const char *filename, FILE *result_file_list)
+{
+  char pgm[MAXNAME + 1], path[MAXPATH + 1];
+  char fout_name[MAXNAME + sizeof(FILE_OUT_SUFFIX)], codefile[MAXNAME + sizeof(".tm")];
+  ServerRequest req;
+  ServerResponse resp;
+  char *data;
+  int ok, stem;
+
+  if (snprintf(pgm, sizeof(pgm), filename[nameStem(filename)] ? "%s" : "%s.tny",
+               filename) >= (int)sizeof(pgm))
+  {
+    fprintf(stderr, "File name too long: %s\n", filename);
+    return FALSE;
+  }
+  stem = nameStem(pgm);
+  snprintf(codefile, sizeof(codefile), "%.*s.tm", stem, pgm);
+  snprintf(fout_name, sizeof(fout_name), "%.*s%s", stem, pgm, FILE_OUT_SUFFIX);
+
+  /* the server opens the file itself, so send an absolute path */
+  if (pgm[0] == '/' || getcwd(path, sizeof(path) - strlen(pgm) - 1) == NULL)
+    strcpy(path, pgm);
+  else
+    strcat(strcat(path, "/"), pgm);
+
+  req.magic = SERVER_MAGIC;
+  req.flags = REQ_TRACE_PARSE | REQ_READ_FILE;
+  req.nameLen = strlen(pgm);
+  req.dataLen = strlen(path);
+  if (!writeFully(fd, &req, sizeof(req)) ||
+      !writeFully(fd, pgm, req.nameLen) ||
+      !writeFully(fd, path, req.dataLen) ||
+      !readFully(fd, &resp, sizeof(resp)) || resp.magic != SERVER_MAGIC)
+  {
+    fprintf(stderr, "lost connection to server\n");
+    exit(1);
+  }
+  if (resp.status == RESP_NOFILE)
+  {
+    fprintf(stderr, "File %s not found\n", pgm);
+    return FALSE;
+  }
+  if (resp.status == RESP_DENIED)
+  {
+    fprintf(stderr, "server of another user refused to read %s\n", pgm);
+    return FALSE;
+  }
+
+  data = (char *)malloc(resp.listingLen + resp.codeLen + 1);
+  if (data == NULL || !readFully(fd, data, resp.listingLen + resp.codeLen))
+  {
+    fprintf(stderr, "lost connection to server\n");
+    exit(1);
+  }
+  if (resp.status == RESP_FAILED)
+  {
+    fprintf(stderr, "server failed to compile %s\n", pgm);
+    free(data);
+    return FALSE;
+  }
+
+  fprintf(result_file_list, "%s\n", fout_name);
+  ok = writeFile(fout_name, data, resp.listingLen);
+  if (ok)
+    printf("result file written: %s\n", fout_name);
+  if (resp.codeLen > 0)
+    ok = writeFile(codefile, data + resp.listingLen, resp.codeLen) && ok;
+  free(data);
+  return ok && resp.status == RESP_OK;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *socketPath = NULL;
+  char defaultPath[MAXSOCKETPATH];
+  FILE *result_file_list;
+  int i, fd, nfailed = 0;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++)
+  {
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+      socketPath = argv[++i];
+    else
+      break;
+  }
+  if (i >= argc)
+  {
+    fprintf(stderr, "usage: %s [-s socket] <filename>...\n", argv[0]);
+    exit(1);
+  }
+
+  if (socketPath == NULL)
+  {
+    if (!defaultSocket(defaultPath, sizeof(defaultPath), FALSE))
+      exit(1);
+    socketPath = defaultPath;
+  }
+  fd = connectServer(socketPath);
+  if (fd < 0)
+  {
+    fprintf(stderr, "cannot connect to server at %s\n", socketPath);
+    exit(1);
+  }
+  result_file_list = fopen(RESULT_FILE_LIST, "a");
+  if (result_file_list == NULL)
+  {
+    fprintf(stderr, "fopen(%s) failed.\n", RESULT_FILE_LIST);
+    exit(1);
+  }
+
+  /* every file goes over the same connection */
+  for (; i < argc; i++)
+    if (!compileRemote(fd, argv[i], result_file_list))
+      nfailed++;
+
+  fclose(result_file_list);
+  close(fd);
+  return nfailed ? -1 : 0;
+}
@@ -0,0 +1,96 @@
+/****************************************************/
+/* File: cminus.c                                   */
+/* libcminus: in-memory compilation API             */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "source.h"
+#include "outbuf.h"
+#include "compile.h"
+#include "cminus.h"
+
+void cminusDefaultOptions(CminusOptions *opts)
+{
+  CompilerContext ctx;
+  initContext(&ctx);
+  opts->EchoSource = ctx.EchoSource;
+  opts->TraceScan = ctx.TraceScan;
+  opts->TraceParse = ctx.TraceParse;
+  opts->TraceAnalyze = ctx.TraceAnalyze;
+  opts->TraceCode = ctx.TraceCode;
+}
+
+int compileToMemory(CompilerContext *ctx, SourceBuffer *sb, const char *name,
+                    CminusResult *result)
+{
+  char codefile[128];
+  OutBuf listing;
+
+  memset(result, 0, sizeof(CminusResult));
+  resetContext(ctx);
+  if (name == NULL)
+    name = "<memory>";
+  snprintf(codefile, sizeof(codefile), "%.*s.tm", (int)strcspn(name, "."), name);
+
+  outInit(&listing, -1);
+  ctx->listing = &listing;
+  ctx->code = open_memstream(&result->code, &result->codeLen);
+  if (ctx->code == NULL)
+  {
+    ctx->listing = NULL;
+    return -1;
+  }
+
+  ctx->source = sb;
+  scanInit(ctx);
+  compile(ctx, name, codefile);
+  scanRelease(ctx);
+
+  result->error = ctx->Error;
+  fclose(ctx->code);
+  result->listing = outDetach(&listing, &result->listingLen);
+  ctx->listing = NULL;
+  ctx->code = NULL;
+  if (listing.error || result->listing == NULL)
+  {
+    outFree(&listing);
+    cminusFreeResult(result);
+    return -1;
+  }
+  return 0;
+}
+
+int cminusCompile(const char *src, size_t len, const char *name,
+                  const CminusOptions *opts, CminusResult *result)
+{
+  CompilerContext context, *ctx = &context;
+  SourceBuffer source;
+  int status;
+
+  memset(result, 0, sizeof(CminusResult));
+  initContext(ctx);
+  if (opts != NULL)
+  {
+    ctx->EchoSource = opts->EchoSource;
+    ctx->TraceScan = opts->TraceScan;
+    ctx->TraceParse = opts->TraceParse;
+    ctx->TraceAnalyze = opts->TraceAnalyze;
+    ctx->TraceCode = opts->TraceCode;
+  }
+  if (!sourceFromBytes(&source, src, len))
+    return -1;
+
+  status = compileToMemory(ctx, &source, name, result);
+  freeContext(ctx);
+  closeSource(&source);
+  return status;
+}
+
+void cminusFreeResult(CminusResult *result)
+{
+  free(result->listing);
+  free(result->code);
+  memset(result, 0, sizeof(CminusResult));
+}
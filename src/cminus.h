@@ -0,0 +1,54 @@
+/****************************************************/
+/* File: cminus.h                                   */
+/* Public interface of libcminus: compiles a C-     */
+/* program held in memory into in-memory listing    */
+/* and TM code buffers                              */
+/****************************************************/
+
+#ifndef _CMINUS_H_
+#define _CMINUS_H_
+
+#include <stddef.h>
+
+/* Tracing flags of a compilation; see globals.h */
+typedef struct
+{
+   int EchoSource;
+   int TraceScan;
+   int TraceParse;
+   int TraceAnalyze;
+   int TraceCode;
+} CminusOptions;
+
+/* Output of a compilation. Both buffers are
+ * NUL terminated and owned by the result.
+ */
+typedef struct
+{
+   char *listing;     /* listing text */
+   size_t listingLen;
+   char *code;        /* TM code, empty unless code generation ran */
+   size_t codeLen;
+   int error;         /* nonzero if a syntax or type error occurred */
+} CminusResult;
+
+/* Procedure cminusDefaultOptions fills opts with
+ * the default tracing flags of hw2_binary
+ */
+void cminusDefaultOptions(CminusOptions *opts);
+
+/* Function cminusCompile compiles the len bytes
+ * at src. name is only used in the listing header.
+ * opts may be NULL for the defaults. Returns 0 on
+ * success, or -1 if the result buffers could not
+ * be allocated. Thread-safe.
+ */
+int cminusCompile(const char *src, size_t len, const char *name,
+                  const CminusOptions *opts, CminusResult *result);
+
+/* Procedure cminusFreeResult releases the buffers
+ * of a result filled in by cminusCompile
+ */
+void cminusFreeResult(CminusResult *result);
+
+#endif
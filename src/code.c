@@ -9,19 +9,15 @@
 #include "globals.h"
 #include "code.h"
 
-/* TM location number for current instruction emission */
-static int emitLoc = 0 ;
-
-/* Highest TM location emitted so far
-   For use in conjunction with emitSkip,
-   emitBackup, and emitRestore */
-static int highEmitLoc = 0;
+/* the current and highest emitted TM locations are
+   kept in ctx->emitLoc and ctx->highEmitLoc, for use
+   with emitSkip, emitBackup, and emitRestore */
 
 /* Procedure emitComment prints a comment line 
  * with comment c in the code file
  */
-void emitComment( char * c )
-{ if (TraceCode) fprintf(code,"* %s\n",c);}
+void emitComment( CompilerContext * ctx, char * c )
+{ if (ctx->TraceCode) fprintf(ctx->code,"* %s\n",c);}
 
 /* Procedure emitRO emits a register-only
  * TM instruction
@@ -29,13 +25,13 @@ void emitComment( char * c )
  * r = target register
  * s = 1st source register
  * t = 2nd source register
- * c = a comment to be printed if TraceCode is TRUE
+ * c = a comment to be printed if ctx->TraceCode is TRUE
  */
-void emitRO( char *op, int r, int s, int t, char *c)
-{ fprintf(code,"%3d:  %5s  %d,%d,%d ",emitLoc++,op,r,s,t);
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
-  if (highEmitLoc < emitLoc) highEmitLoc = emitLoc ;
+void emitRO( CompilerContext * ctx, char *op, int r, int s, int t, char *c)
+{ fprintf(ctx->code,"%3d:  %5s  %d,%d,%d ",ctx->emitLoc++,op,r,s,t);
+  if (ctx->TraceCode) fprintf(ctx->code,"\t%s",c) ;
+  fprintf(ctx->code,"\n") ;
+  if (ctx->highEmitLoc < ctx->emitLoc) ctx->highEmitLoc = ctx->emitLoc ;
 } /* emitRO */
 
 /* Procedure emitRM emits a register-to-memory
@@ -44,40 +40,40 @@ void emitRO( char *op, int r, int s, int t, char *c)
  * r = target register
  * d = the offset
  * s = the base register
- * c = a comment to be printed if TraceCode is TRUE
+ * c = a comment to be printed if ctx->TraceCode is TRUE
  */
-void emitRM( char * op, int r, int d, int s, char *c)
-{ fprintf(code,"%3d:  %5s  %d,%d(%d) ",emitLoc++,op,r,d,s);
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
-  if (highEmitLoc < emitLoc)  highEmitLoc = emitLoc ;
+void emitRM( CompilerContext * ctx, char * op, int r, int d, int s, char *c)
+{ fprintf(ctx->code,"%3d:  %5s  %d,%d(%d) ",ctx->emitLoc++,op,r,d,s);
+  if (ctx->TraceCode) fprintf(ctx->code,"\t%s",c) ;
+  fprintf(ctx->code,"\n") ;
+  if (ctx->highEmitLoc < ctx->emitLoc)  ctx->highEmitLoc = ctx->emitLoc ;
 } /* emitRM */
 
 /* Function emitSkip skips "howMany" code
  * locations for later backpatch. It also
  * returns the current code position
  */
-int emitSkip( int howMany)
-{  int i = emitLoc;
-   emitLoc += howMany ;
-   if (highEmitLoc < emitLoc)  highEmitLoc = emitLoc ;
+int emitSkip( CompilerContext * ctx, int howMany)
+{  int i = ctx->emitLoc;
+   ctx->emitLoc += howMany ;
+   if (ctx->highEmitLoc < ctx->emitLoc)  ctx->highEmitLoc = ctx->emitLoc ;
    return i;
 } /* emitSkip */
 
 /* Procedure emitBackup backs up to 
  * loc = a previously skipped location
  */
-void emitBackup( int loc)
-{ if (loc > highEmitLoc) emitComment("BUG in emitBackup");
-  emitLoc = loc ;
+void emitBackup( CompilerContext * ctx, int loc)
+{ if (loc > ctx->highEmitLoc) emitComment(ctx,"BUG in emitBackup");
+  ctx->emitLoc = loc ;
 } /* emitBackup */
 
 /* Procedure emitRestore restores the current 
  * code position to the highest previously
  * unemitted position
  */
-void emitRestore(void)
-{ emitLoc = highEmitLoc;}
+void emitRestore(CompilerContext * ctx)
+{ ctx->emitLoc = ctx->highEmitLoc;}
 
 /* Procedure emitRM_Abs converts an absolute reference 
  * to a pc-relative reference when emitting a
@@ -85,13 +81,13 @@ void emitRestore(void)
  * op = the opcode
  * r = target register
  * a = the absolute location in memory
- * c = a comment to be printed if TraceCode is TRUE
+ * c = a comment to be printed if ctx->TraceCode is TRUE
  */
-void emitRM_Abs( char *op, int r, int a, char * c)
-{ fprintf(code,"%3d:  %5s  %d,%d(%d) ",
-               emitLoc,op,r,a-(emitLoc+1),pc);
-  ++emitLoc ;
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
-  if (highEmitLoc < emitLoc) highEmitLoc = emitLoc ;
+void emitRM_Abs( CompilerContext * ctx, char *op, int r, int a, char * c)
+{ fprintf(ctx->code,"%3d:  %5s  %d,%d(%d) ",
+               ctx->emitLoc,op,r,a-(ctx->emitLoc+1),pc);
+  ++ctx->emitLoc ;
+  if (ctx->TraceCode) fprintf(ctx->code,"\t%s",c) ;
+  fprintf(ctx->code,"\n") ;
+  if (ctx->highEmitLoc < ctx->emitLoc) ctx->highEmitLoc = ctx->emitLoc ;
 } /* emitRM_Abs */
@@ -34,7 +34,7 @@
 /* Procedure emitComment prints a comment line 
  * with comment c in the code file
  */
-void emitComment( char * c );
+void emitComment( CompilerContext * ctx, char * c );
 
 /* Procedure emitRO emits a register-only
  * TM instruction
@@ -44,7 +44,7 @@ void emitComment( char * c );
  * t = 2nd source register
  * c = a comment to be printed if TraceCode is TRUE
  */
-void emitRO( char *op, int r, int s, int t, char *c);
+void emitRO( CompilerContext * ctx, char *op, int r, int s, int t, char *c);
 
 /* Procedure emitRM emits a register-to-memory
  * TM instruction
@@ -54,24 +54,24 @@ void emitRO( char *op, int r, int s, int t, char *c);
  * s = the base register
  * c = a comment to be printed if TraceCode is TRUE
  */
-void emitRM( char * op, int r, int d, int s, char *c);
+void emitRM( CompilerContext * ctx, char * op, int r, int d, int s, char *c);
 
 /* Function emitSkip skips "howMany" code
  * locations for later backpatch. It also
  * returns the current code position
  */
-int emitSkip( int howMany);
+int emitSkip( CompilerContext * ctx, int howMany);
 
 /* Procedure emitBackup backs up to 
  * loc = a previously skipped location
  */
-void emitBackup( int loc);
+void emitBackup( CompilerContext * ctx, int loc);
 
 /* Procedure emitRestore restores the current 
  * code position to the highest previously
  * unemitted position
  */
-void emitRestore(void);
+void emitRestore(CompilerContext * ctx);
 
 /* Procedure emitRM_Abs converts an absolute reference 
  * to a pc-relative reference when emitting a
@@ -81,6 +81,6 @@ void emitRestore(void);
  * a = the absolute location in memory
  * c = a comment to be printed if TraceCode is TRUE
  */
-void emitRM_Abs( char *op, int r, int a, char * c);
+void emitRM_Abs( CompilerContext * ctx, char *op, int r, int a, char * c);
 
 #endif
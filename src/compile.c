@@ -0,0 +1,125 @@
+/****************************************************/
+/* File: compile.c                                  */
+/* Compilation driver shared by hw2_binary and      */
+/* libcminus                                        */
+/****************************************************/
+
+#include "globals.h"
+
+/* set NO_PARSE to TRUE to get a scanner-only compiler */
+#define NO_PARSE FALSE
+/* set NO_ANALYZE to TRUE to get a parser-only compiler */
+#define NO_ANALYZE TRUE
+
+/* set NO_CODE to TRUE to get a compiler that does not
+ * generate code
+ */
+#define NO_CODE FALSE
+
+#include "util.h"
+#include "outbuf.h"
+#include "scan.h"
+#include "compile.h"
+#include "timing.h"
+#if !NO_PARSE
+#include "parse.h"
+#include "ctree.h"
+#if !NO_ANALYZE
+#include "analyze.h"
+#include "symtab.h"
+#if !NO_CODE
+#include "cgen.h"
+#endif
+#endif
+#endif
+
+unsigned compileFlags(const CompilerContext *ctx)
+{
+  return (ctx->EchoSource ? 0x01 : 0) | (ctx->TraceScan ? 0x02 : 0) |
+         (ctx->TraceParse ? 0x04 : 0) | (ctx->TraceAnalyze ? 0x08 : 0) |
+         (ctx->TraceCode ? 0x10 : 0) | (NO_PARSE ? 0x100 : 0) |
+         (NO_ANALYZE ? 0x200 : 0) | (NO_CODE ? 0x400 : 0) |
+         (ctx->parserEngine == ParseLalr ? 0x800 : 0) |
+         ((unsigned)(ctx->maxErrors - 1) & 0xffff) << 16;
+}
+
+void compile(CompilerContext *ctx, const char *pgm, const char *codefile)
+{
+  TreeNode *syntaxTree;
+#if !NO_PARSE
+  CompactTree *compact = NULL;
+#endif
+
+  spanBegin(ctx, "compile");
+  outPrintf(ctx->listing, "\nC- COMPILATION: %s\n", pgm);
+#if NO_PARSE
+  outPrintf(ctx->listing, "%-20s%-20s%s\n", "line number", "token", "lexeme");
+  outPrintf(ctx->listing, "================================================================================\n");
+  TokenType tokenType;
+  while ((tokenType = getToken(ctx)) != ENDFILE)
+    printToken(ctx, tokenType, tokenText(ctx));
+  if (tokenType == ENDFILE) /* print EOF */
+    printToken(ctx, tokenType, tokenText(ctx));
+
+#else
+  phaseBegin(ctx, PhaseParse);
+  syntaxTree = ctx->parserEngine == ParseLalr ? lalrParse(ctx) : parse(ctx);
+  if (ctx->compactAst && !ctx->Error)
+    compact = compactTree(ctx, syntaxTree);
+  phaseEnd(ctx, PhaseParse);
+  if (ctx->TraceParse && !ctx->Error)
+  {
+    phaseBegin(ctx, PhasePrint);
+    outPrintf(ctx->listing, "\nSyntax tree:\n");
+    if (compact != NULL)
+      printCompactTree(ctx, compact);
+    else
+      printTree(ctx, syntaxTree);
+    phaseEnd(ctx, PhasePrint);
+  }
+#if !NO_ANALYZE
+  if (!ctx->Error)
+  {
+    phaseBegin(ctx, PhaseAnalyze);
+    if (ctx->TraceAnalyze)
+      outPrintf(ctx->listing, "\nBuilding Symbol Table...\n");
+    buildSymtab(ctx, syntaxTree);
+    if (ctx->TraceAnalyze)
+      outPrintf(ctx->listing, "\nChecking Types...\n");
+    typeCheck(ctx, syntaxTree);
+    if (ctx->TraceAnalyze)
+      outPrintf(ctx->listing, "\nType Checking Finished\n");
+    phaseEnd(ctx, PhaseAnalyze);
+  }
+#if !NO_CODE
+  if (!ctx->Error)
+  {
+    FILE *codeFile = NULL;
+    if (ctx->code == NULL)
+    {
+      codeFile = fopen(codefile, "w");
+      if (codeFile == NULL)
+      {
+        fprintf(stderr, "Unable to open %s\n", codefile);
+        ctx->Error = TRUE;
+      }
+      ctx->code = codeFile;
+    }
+    if (ctx->code != NULL)
+    {
+      phaseBegin(ctx, PhaseCode);
+      codeGen(ctx, syntaxTree, (char *)codefile);
+      phaseEnd(ctx, PhaseCode);
+    }
+    if (codeFile != NULL)
+    {
+      fclose(codeFile);
+      ctx->code = NULL;
+    }
+  }
+#endif
+  st_free(ctx);
+#endif
+#endif
+  spanEnd(ctx, pgm);
+}
@@ -0,0 +1,39 @@
+/****************************************************/
+/* File: compile.h                                  */
+/* Compilation driver shared by hw2_binary and      */
+/* libcminus                                        */
+/****************************************************/
+
+#ifndef _COMPILE_H_
+#define _COMPILE_H_
+
+#include "cminus.h"
+
+/* Procedure compile runs every enabled phase over
+ * the source attached to ctx (see scanInit) and
+ * writes the listing to ctx->listing. pgm is the
+ * name printed in the listing header. TM code goes
+ * to ctx->code, or to a new file named codefile if
+ * ctx->code is NULL.
+ */
+void compile(CompilerContext *ctx, const char *pgm, const char *codefile);
+
+/* Function compileFlags returns the tracing flags
+ * of ctx, its parser and syntax error limit and the
+ * NO_PARSE/NO_ANALYZE/NO_CODE phase selection as one word:
+ * two compilations of the same source with equal
+ * flags give equal output
+ */
+unsigned compileFlags(const CompilerContext *ctx);
+
+/* Function compileToMemory compiles sb with the
+ * tracing flags already set in ctx and returns the
+ * listing and TM code in result. ctx is reset first
+ * and keeps its scanner afterwards, so it can be
+ * reused for the next source. Returns 0 on success,
+ * or -1 if the result buffers could not be allocated.
+ */
+int compileToMemory(CompilerContext *ctx, SourceBuffer *sb, const char *name,
+                    CminusResult *result);
+
+#endif
@@ -0,0 +1,195 @@
+/****************************************************/
+/* File: ctree.c                                    */
+/* Compact syntax tree (--compact-ast): the nodes   */
+/* of a TreeNode tree as 32-bit indices into arrays */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "outbuf.h"
+#include "intern.h"
+#include "arena.h"
+#include "ctree.h"
+
+/* does a node of this kind have an identifier in attr.name? */
+static int isNamed(const TreeNode *t)
+{
+  if (t->nodekind == StmtK)
+    return t->kind.stmt == VarDeclK || t->kind.stmt == ArrayDeclK ||
+           t->kind.stmt == FuncDeclK;
+  if (t->nodekind == ExpK)
+    return t->kind.exp == IdK || t->kind.exp == VarCallK || t->kind.exp == ArrayCallK ||
+           t->kind.exp == FuncCallK || t->kind.exp == ParamK;
+  return FALSE;
+}
+
+/* count the nodes of the sibling list t and the
+ * largest name id in it
+ */
+static size_t countNodes(const TreeNode *t, uint32_t *nnames)
+{
+  size_t n = 0;
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    n++;
+    if (isNamed(t) && t->attr.name != NULL && (uint32_t)nameId(t->attr.name) >= *nnames)
+      *nnames = nameId(t->attr.name) + 1;
+    for (i = 0; i < MAXCHILDREN; i++)
+      n += countNodes(t->child[i], nnames);
+  }
+  return n;
+}
+
+/* append the sibling list t, in child slot slot of
+ * its parent, at depth; returns the index of its
+ * last node
+ */
+static uint32_t putNodes(CompactTree *ct, const TreeNode *t, int slot, uint32_t depth)
+{
+  uint32_t prev = 0;
+  int i, first = TRUE;
+  for (; t != NULL; t = t->sibling)
+  {
+    uint32_t k = ct->n++, last = 0; /* no child is node 0 */
+    uint32_t payload = 0;
+    int kind = t->nodekind == StmtK ? t->kind.stmt : t->nodekind == ExpK ? t->kind.exp : 0;
+    int link = slot;
+
+    if (!first)
+      ct->next[prev] = k;
+    first = FALSE;
+    if (t->nodekind == TypeK || isNamed(t))
+      link |= t->type << CT_TYPESHIFT;
+    if (isNamed(t))
+    {
+      payload = t->attr.name != NULL ? (uint32_t)nameId(t->attr.name) : CT_NONAME;
+      if (t->attr.name != NULL)
+        ct->names[payload] = t->attr.name;
+    }
+    else if (t->nodekind == ExpK && t->kind.exp == OpK)
+      payload = t->attr.op;
+    else if (t->nodekind == ExpK && t->kind.exp == ConstK)
+      payload = (uint32_t)t->attr.val;
+    else if (t->nodekind == ArrSizeK)
+      payload = (uint32_t)t->arr_size;
+    ct->kind[k] = CT_KIND(t->nodekind, kind);
+    ct->depth[k] = depth;
+    ct->offset[k] = (uint32_t)t->offset;
+    ct->payload[k] = payload;
+    ct->next[k] = 0;
+
+    /* the children: one sibling list over the slots */
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (t->child[i] != NULL)
+      {
+        if (last == 0)
+          link |= CT_KIDS;
+        else
+          ct->next[last] = ct->n;
+        last = putNodes(ct, t->child[i], i, depth + 1);
+      }
+    ct->link[k] = link;
+    prev = k;
+  }
+  return prev;
+}
+
+CompactTree *compactTree(CompilerContext *ctx, TreeNode *tree)
+{
+  CompactTree *ct;
+  uint32_t nnames = 0;
+  size_t n = countNodes(tree, &nnames);
+
+  if (n >= UINT32_MAX || ctx->source->len > UINT32_MAX)
+    return NULL;
+  ct = (CompactTree *)arenaAlloc(ctx, sizeof(CompactTree), SiteCompactTree, 0);
+  if (ct == NULL)
+    return NULL;
+  ct->n = 0;
+  ct->nnames = nnames;
+  ct->kind = (uint8_t *)arenaAlloc(ctx, n, SiteCompactTree, 0);
+  ct->link = (uint8_t *)arenaAlloc(ctx, n, SiteCompactTree, 0);
+  ct->next = (uint32_t *)arenaAlloc(ctx, n * sizeof(uint32_t), SiteCompactTree, 0);
+  ct->depth = (uint32_t *)arenaAlloc(ctx, n * sizeof(uint32_t), SiteCompactTree, 0);
+  ct->offset = (uint32_t *)arenaAlloc(ctx, n * sizeof(uint32_t), SiteCompactTree, 0);
+  ct->payload = (uint32_t *)arenaAlloc(ctx, n * sizeof(uint32_t), SiteCompactTree, 0);
+  ct->names = (const char **)arenaAlloc(ctx, nnames * sizeof(const char *), SiteCompactTree, 0);
+  if (ct->kind == NULL || ct->link == NULL || ct->next == NULL || ct->depth == NULL ||
+      ct->offset == NULL || ct->payload == NULL || ct->names == NULL)
+    return NULL;
+  putNodes(ct, tree, 0, 0);
+  return ct;
+}
+
+static const char *stmtLabel[] = {
+    "If", "Else", "Assign : =", "Compound Statement", "While", "Return",
+    "Variable Declare : ", "Array Declare : ", "Function Declare : "};
+
+static const char *expLabel[] = {
+    "Op: ", "Const: ", "Id: ", "Variable: ", "Array: ", "Function Call: ",
+    "Parameter(s)", "Variable: ", "Argument(s)", "Simple Expression",
+    "Additive Expression", "Term", "Index"};
+
+static const char *typeLabel[] = {"Type: void", "Type: int", "Type: int[]"};
+
+#define NLABELS(a) (int)(sizeof(a) / sizeof(a[0]))
+
+void printCompactTree(CompilerContext *ctx, const CompactTree *ct)
+{
+  OutBuf *out = ctx->listing;
+  uint32_t i;
+  for (i = 0; i < ct->n; i++)
+  {
+    int kind = CT_SUBKIND(ct->kind[i]);
+    int type = ct->link[i] >> CT_TYPESHIFT;
+    uint32_t payload = ct->payload[i];
+    const char *name = payload < ct->nnames ? ct->names[payload] : NULL;
+
+    outIndent(out, ctx->indentno + 2 * (ct->depth[i] + 1));
+    switch (CT_NODEKIND(ct->kind[i]))
+    {
+    case StmtK:
+      if (kind >= NLABELS(stmtLabel))
+        outPuts(out, "Unknown ExpNode kind\n");
+      else if (kind >= VarDeclK)
+        outLine(out, stmtLabel[kind], name);
+      else
+        outLine(out, stmtLabel[kind], "");
+      break;
+    case ExpK:
+      if (kind >= NLABELS(expLabel))
+        outPuts(out, "Unknown ExpNode kind\n");
+      else if (kind == OpK)
+      {
+        outPuts(out, expLabel[kind]);
+        printToken(ctx, (TokenType)payload, "\0");
+      }
+      else if (kind == ConstK)
+      {
+        outPuts(out, expLabel[kind]);
+        outInt(out, (int)payload);
+        outChar(out, '\n');
+      }
+      else if (kind <= FuncCallK || kind == ParamK)
+        outLine(out, expLabel[kind], name);
+      else
+        outLine(out, expLabel[kind], "");
+      break;
+    case TypeK:
+      if (type < NLABELS(typeLabel))
+        outLine(out, typeLabel[type], "");
+      else
+        outPuts(out, "Unknown type\n");
+      break;
+    case ArrSizeK:
+      outPuts(out, "Size: ");
+      outInt(out, (int)payload);
+      outChar(out, '\n');
+      break;
+    default:
+      outPuts(out, "Unknown node kind\n");
+      break;
+    }
+  }
+}
@@ -0,0 +1,58 @@
+/****************************************************/
+/* File: ctree.h                                    */
+/* Compact syntax tree (--compact-ast): the nodes   */
+/* of a TreeNode tree as 32-bit indices into arrays */
+/****************************************************/
+
+#ifndef _CTREE_H_
+#define _CTREE_H_
+
+#include <stdint.h>
+
+/* The nodes are numbered in preorder, so a node's
+ * first child, if it has one, is the next node and
+ * a walk in index order visits the tree as
+ * printTree() does. The children of a node form one
+ * sibling list across its child slots; link[] tells
+ * which slot each is in. Each array has one entry
+ * per node (struct of arrays); the payload of a node
+ * depends on its kind.
+ */
+typedef struct compactTree
+{
+  uint32_t n;        /* nodes */
+  uint8_t *kind;     /* CT_KIND(nodekind, StmtKind or ExpKind) */
+  uint8_t *link;     /* child slot, CT_KIDS, and ExpType << CT_TYPESHIFT */
+  uint32_t *next;    /* next sibling, 0 if none (node 0 is the root) */
+  uint32_t *depth;   /* 0 for the top-level list */
+  uint32_t *offset;  /* of the first token in the source */
+  uint32_t *payload; /* OpK: TokenType, ConstK: value, ArrSizeK: size,
+                        named kinds: index in names, CT_NONAME if none */
+  const char **names; /* the interned names, by nameId() */
+  uint32_t nnames;
+} CompactTree;
+
+#define CT_KIND(nodekind, kind) ((nodekind) << 4 | (kind))
+#define CT_NODEKIND(k) ((NodeKind)((k) >> 4))
+#define CT_SUBKIND(k) ((k) & 15)
+
+#define CT_SLOT 3      /* child slot of the parent, 0..MAXCHILDREN-1 */
+#define CT_KIDS 4      /* the node has children: the first is the next node */
+#define CT_TYPESHIFT 3 /* ExpType: TypeK nodes, declarations and parameters */
+
+#define CT_NONAME UINT32_MAX
+
+/* Function compactTree builds the compact form of
+ * tree in the tree arena of ctx (arena.h). Returns
+ * NULL if out of memory or there are too many nodes
+ * or source bytes for 32-bit indices.
+ */
+CompactTree *compactTree(CompilerContext *ctx, TreeNode *tree);
+
+/* Procedure printCompactTree prints ct to the
+ * listing file exactly as printTree() prints the
+ * tree it was built from
+ */
+void printCompactTree(CompilerContext *ctx, const CompactTree *ct);
+
+#endif
@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <setjmp.h>
 
 #ifndef FALSE
 #define FALSE 0
@@ -25,6 +26,9 @@
 /* MAXRESERVED = the number of reserved words */
 #define MAXRESERVED 6
 
+/* MAXTOKENLEN is the maximum size of a token */
+#define MAXTOKENLEN 40
+
 typedef enum
 /* book-keeping tokens */
 {
@@ -72,12 +76,6 @@ typedef enum
    RBRACKET,
 } TokenType;
 
-extern FILE *source;  /* source code text file */
-extern FILE *listing; /* listing output text file */
-extern FILE *code;    /* code text file for TM simulator */
-
-extern int lineno; /* source line number for listing */
-
 /**************************************************/
 /***********   Syntax tree for parsing ************/
 /**************************************************/
@@ -125,6 +123,8 @@ typedef enum
    ParamK,     /* A single parameter */
    ArgK,       /* Argument() of function call */
 
+   /* only built around an operator: a lone operand
+      stands for its expression, unwrapped (parse.c) */
    SimpleExpK, /* simple-expression */
    AddExpK,    /* additive-expression */
    TermK,      /* term */
@@ -147,7 +147,7 @@ typedef struct treeNode
 {
    struct treeNode *child[MAXCHILDREN];
    struct treeNode *sibling;
-   int lineno;
+   size_t offset; /* of its first token in source->text; see lineOf() */
    NodeKind nodekind;
    union
    {
@@ -158,44 +158,143 @@ typedef struct treeNode
    {
       TokenType op;
       int val;
-      char *name;
+      const char *name; /* interned: see intern.h */
    } attr;
    ExpType type; /* for type checking of exps */
    int arr_size;
 } TreeNode;
 
 /**************************************************/
-/***********   Flags for tracing       ************/
+/***********   Compiler context        ************/
 /**************************************************/
 
-/* EchoSource = TRUE causes the source program to
- * be echoed to the listing file with line numbers
- * during parsing
- */
-extern int EchoSource;
-
-/* TraceScan = TRUE causes token information to be
- * printed to the listing file as each token is
- * recognized by the scanner
+/* A SourceBuffer holds the whole source text,
+ * followed by the two NUL bytes that the flex
+ * scanner requires at the end of its buffer.
+ * Locations are byte offsets into text; the
+ * newline index that turns them into lines is
+ * only built when lineOf() needs it (source.h).
  */
-extern int TraceScan;
-
-/* TraceParse = TRUE causes the syntax tree to be
- * printed to the listing file in linearized form
- * (using indents for children)
+typedef struct
+{
+   char *text;  /* source bytes */
+   size_t len;  /* number of source bytes */
+   size_t size; /* bytes allocated or mapped at text */
+   int mapped;  /* TRUE if text is an mmap()ed file */
+
+   size_t *newlines; /* offsets of the \n bytes in text[0..indexed) */
+   int nnewlines;    /* entries used in newlines */
+   int maxnewlines;  /* entries allocated in newlines */
+   size_t indexed;   /* bytes of text searched for \n so far */
+} SourceBuffer;
+
+/* A TokenSpan locates a token in the source
+ * buffer; its lexeme is only copied out when the
+ * syntax tree keeps it
  */
-extern int TraceParse;
+typedef struct
+{
+   TokenType kind;
+   size_t offset; /* of the lexeme in source->text */
+   int len;       /* bytes in the lexeme */
+} TokenSpan;
 
-/* TraceAnalyze = TRUE causes symbol table inserts
- * and lookups to be reported to the listing file
- */
-extern int TraceAnalyze;
+/* ScanEngine selects the scanner behind getToken() */
+typedef enum
+{
+   ScanFlex,   /* flex-generated, lex/cminus.l */
+   ScanDirect, /* direct-coded, scan.c */
+} ScanEngine;
 
-/* TraceCode = TRUE causes comments to be written
- * to the TM code file as code is generated
+/* ParserEngine selects the parser compile() runs */
+typedef enum
+{
+   ParseRd,   /* recursive descent, parse.c */
+   ParseLalr, /* Bison-generated LALR(1), yacc/cminus.y */
+} ParserEngine;
+
+/* A CompilerContext holds all the state of a single
+ * compilation. Every phase takes it as its first
+ * argument, so independent compilations can run
+ * concurrently on separate threads.
  */
-extern int TraceCode;
-
-/* Error = TRUE prevents further passes if an error occurs */
-extern int Error;
+typedef struct compilerContext
+{
+   SourceBuffer *source; /* source code text */
+   struct outBuf *listing; /* listing output (outbuf.h) */
+   FILE *code;           /* code text file for TM simulator */
+
+   /* EchoSource = TRUE causes the source program to
+    * be echoed to the listing file with line numbers
+    * during parsing
+    */
+   int EchoSource;
+
+   /* TraceScan = TRUE causes token information to be
+    * printed to the listing file as each token is
+    * recognized by the scanner
+    */
+   int TraceScan;
+
+   /* TraceParse = TRUE causes the syntax tree to be
+    * printed to the listing file in linearized form
+    * (using indents for children)
+    */
+   int TraceParse;
+
+   /* TraceAnalyze = TRUE causes symbol table inserts
+    * and lookups to be reported to the listing file
+    */
+   int TraceAnalyze;
+
+   /* TraceCode = TRUE causes comments to be written
+    * to the TM code file as code is generated
+    */
+   int TraceCode;
+
+   /* Error = TRUE prevents further passes if an error occurs */
+   int Error;
+
+   /* scanner state */
+   ScanEngine scanEngine;              /* set before scanInit() */
+   void *scanner;                      /* reentrant flex scanner (yyscan_t) */
+   const char *scanPos;                /* next byte for ScanDirect */
+   int skipComments;                   /* TRUE: never return COMMENT tokens */
+   int pipelineScan;                   /* TRUE: scan on a thread of its own */
+   struct tokenPipe *pipe;             /* that thread's token ring (tokpipe.h) */
+   int lexThreads;                     /* > 1: lex large sources in that many chunks */
+   struct tokenChunks *chunks;         /* their tokens (chunklex.h) */
+   struct tokenFile *tokens;           /* tokens read back from a token file (util.h) */
+   struct timedBatch *timed;           /* tokens scanned ahead for --time-report (scan.c) */
+   TokenSpan tok;                      /* the current token */
+   char tokenString[MAXTOKENLEN + 1]; /* lexeme of tok, see tokenText() */
+
+   /* parser state */
+   TokenType token;  /* holds current token */
+   jmp_buf failJump; /* syntax errors jump back to parse() */
+   jmp_buf *recover; /* or to the innermost recovery point (parse.c) */
+   int syntaxErrors; /* reported by this parse */
+   int maxErrors;    /* parse stops after that many; 0: no limit */
+   struct internTable *names; /* identifiers of the tree (intern.h) */
+   struct arena *arena;       /* memory of the tree (arena.h) */
+   struct shareTable *shared; /* shared leaf nodes of the tree (share.h) */
+   int compactAst;            /* TRUE: print the tree from its compact form (ctree.h) */
+   ParserEngine parserEngine;
+
+   /* printTree state */
+   int indentno; /* current number of spaces to indent */
+
+   /* analyzer state */
+   int location;   /* counter for variable memory locations */
+   void *symtab;   /* symbol table, owned by symtab.c */
+
+   /* code generator state */
+   int emitLoc;     /* TM location number for current instruction emission */
+   int highEmitLoc; /* highest TM location emitted so far */
+   int tmpOffset;   /* memory offset for temps */
+
+   /* instrumentation, owned by the driver; NULL when off */
+   struct timing *timing;   /* phase times and trace spans (timing.h) */
+   struct memStat *memstat; /* allocation counters (memstat.h) */
+} CompilerContext;
 #endif
@@ -0,0 +1,222 @@
+/****************************************************/
+/* File: intern.c                                   */
+/* Identifier interning: one canonical copy of each */
+/* distinct name per compiler context               */
+/****************************************************/
+
+#include "globals.h"
+#include "memstat.h"
+#include "intern.h"
+
+/* INITSLOTS is the initial size of the hash table;
+ * it must be a power of two. internReset shrinks a
+ * table grown past MAXKEPTSLOTS back to it.
+ */
+#define INITSLOTS 256
+#define MAXKEPTSLOTS (INITSLOTS * 64)
+
+/* BLOCKSIZE is the size of the blocks names are
+ * copied into
+ */
+#define BLOCKSIZE (16 * 1024)
+
+/* a name in a block is its id, then its bytes and
+ * a '\0'; records start on an int boundary
+ */
+#define RECORDSIZE(len) \
+  ((sizeof(int) + (len) + 1 + sizeof(int) - 1) & ~(sizeof(int) - 1))
+
+typedef struct
+{
+  unsigned hash;
+  int len;
+  const char *name; /* NULL if the slot is free */
+} InternSlot;
+
+typedef struct nameBlock
+{
+  struct nameBlock *next;
+  size_t size; /* bytes in text */
+  char text[];
+} NameBlock;
+
+typedef struct internTable
+{
+  InternSlot *slot;
+  unsigned mask;  /* slots - 1 */
+  int count;      /* names in the table */
+  NameBlock *blocks;
+  NameBlock *cur; /* the block names are added to */
+  size_t used;    /* bytes of cur taken */
+} InternTable;
+
+/* FNV-1a */
+static unsigned hashName(const char *s, int len)
+{
+  unsigned h = 2166136261u;
+  int i;
+  for (i = 0; i < len; i++)
+    h = (h ^ (unsigned char)s[i]) * 16777619u;
+  return h;
+}
+
+static InternTable *table(CompilerContext *ctx)
+{
+  InternTable *t = ctx->names;
+  if (t == NULL)
+  {
+    t = (InternTable *)calloc(1, sizeof(InternTable));
+    if (t == NULL)
+      return NULL;
+    t->slot = (InternSlot *)calloc(INITSLOTS, sizeof(InternSlot));
+    if (t->slot == NULL)
+    {
+      free(t);
+      return NULL;
+    }
+    t->mask = INITSLOTS - 1;
+    ctx->names = t;
+  }
+  return t;
+}
+
+/* double the hash table */
+static int grow(InternTable *t)
+{
+  unsigned n = (t->mask + 1) * 2, i;
+  InternSlot *slot = (InternSlot *)calloc(n, sizeof(InternSlot));
+  if (slot == NULL)
+    return FALSE;
+  for (i = 0; i <= t->mask; i++)
+    if (t->slot[i].name != NULL)
+    {
+      unsigned j = t->slot[i].hash & (n - 1);
+      while (slot[j].name != NULL)
+        j = (j + 1) & (n - 1);
+      slot[j] = t->slot[i];
+    }
+  free(t->slot);
+  t->slot = slot;
+  t->mask = n - 1;
+  return TRUE;
+}
+
+/* room for a record of size bytes */
+static char *reserve(InternTable *t, size_t size)
+{
+  char *p;
+  while (t->cur == NULL || t->used + size > t->cur->size)
+  {
+    NameBlock *b;
+    if (t->cur != NULL && t->cur->next != NULL)
+    { /* a block kept by internReset */
+      t->cur = t->cur->next;
+      t->used = 0;
+      continue;
+    }
+    if (t->cur == NULL && t->blocks != NULL)
+    {
+      t->cur = t->blocks;
+      t->used = 0;
+      continue;
+    }
+    b = (NameBlock *)malloc(sizeof(NameBlock) + (size > BLOCKSIZE ? size : BLOCKSIZE));
+    if (b == NULL)
+      return NULL;
+    b->next = NULL;
+    b->size = size > BLOCKSIZE ? size : BLOCKSIZE;
+    if (t->cur != NULL)
+      t->cur->next = b;
+    else
+      t->blocks = b;
+    t->cur = b;
+    t->used = 0;
+  }
+  p = t->cur->text + t->used;
+  t->used += size;
+  return p;
+}
+
+const char *internName(CompilerContext *ctx, const char *s, int len)
+{
+  InternTable *t = table(ctx);
+  unsigned h, i;
+  char *p;
+
+  if (t == NULL)
+    return NULL;
+  h = hashName(s, len);
+  for (i = h & t->mask; t->slot[i].name != NULL; i = (i + 1) & t->mask)
+    if (t->slot[i].hash == h && t->slot[i].len == len &&
+        memcmp(t->slot[i].name, s, len) == 0)
+      return t->slot[i].name;
+
+  /* a new name: keep the table at most half full */
+  if ((unsigned)(t->count + 1) * 2 > t->mask + 1)
+  {
+    if (!grow(t))
+      return NULL;
+    for (i = h & t->mask; t->slot[i].name != NULL; i = (i + 1) & t->mask)
+      ;
+  }
+  /* counted per name, as the arena counts per node,
+   * so that every compilation shows its names
+   */
+  countAlloc(ctx, RECORDSIZE(len), SiteString, 0);
+  p = reserve(t, RECORDSIZE(len));
+  if (p == NULL)
+    return NULL;
+  *(int *)p = t->count++;
+  p += sizeof(int);
+  memcpy(p, s, len);
+  p[len] = '\0';
+  t->slot[i].hash = h;
+  t->slot[i].len = len;
+  t->slot[i].name = p;
+  return p;
+}
+
+int nameId(const char *name)
+{
+  return ((const int *)name)[-1];
+}
+
+void internReset(CompilerContext *ctx)
+{
+  InternTable *t = ctx->names;
+  if (t == NULL || t->count == 0)
+    return;
+  if (t->mask + 1 > MAXKEPTSLOTS)
+  {
+    InternSlot *slot = (InternSlot *)calloc(MAXKEPTSLOTS, sizeof(InternSlot));
+    if (slot != NULL)
+    {
+      free(t->slot);
+      t->slot = slot;
+      t->mask = MAXKEPTSLOTS - 1;
+    }
+    else
+      memset(t->slot, 0, (t->mask + 1) * sizeof(InternSlot));
+  }
+  else
+    memset(t->slot, 0, (t->mask + 1) * sizeof(InternSlot));
+  t->count = 0;
+  t->cur = NULL;
+  t->used = 0;
+}
+
+void internFree(CompilerContext *ctx)
+{
+  InternTable *t = ctx->names;
+  if (t == NULL)
+    return;
+  while (t->blocks != NULL)
+  {
+    NameBlock *next = t->blocks->next;
+    free(t->blocks);
+    t->blocks = next;
+  }
+  free(t->slot);
+  free(t);
+  ctx->names = NULL;
+}
@@ -0,0 +1,32 @@
+/****************************************************/
+/* File: intern.h                                   */
+/* Identifier interning: one canonical copy of each */
+/* distinct name per compiler context               */
+/****************************************************/
+
+#ifndef _INTERN_H_
+#define _INTERN_H_
+
+/* Function internName returns the canonical copy
+ * of the len bytes at s, adding it on first use.
+ * Equal names give the same pointer, so interned
+ * names compare with ==. The copy is immutable and
+ * lives until the next internReset of ctx. Returns
+ * NULL if out of memory.
+ */
+const char *internName(CompilerContext *ctx, const char *s, int len);
+
+/* Function nameId returns the small id of an
+ * interned name: 0, 1, 2, ... in order of first use
+ */
+int nameId(const char *name);
+
+/* Procedure internReset forgets the names of ctx,
+ * keeping the memory for the next compilation
+ */
+void internReset(CompilerContext *ctx);
+
+/* Procedure internFree releases the names of ctx */
+void internFree(CompilerContext *ctx);
+
+#endif
@@ -0,0 +1,148 @@
+/****************************************************/
+/* File: lexcheck.c                                 */
+/* Checks that parallel lexing (--lex-threads)      */
+/* gives the token stream of the sequential flex    */
+/* scanner, for both engines and every chunking    */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "source.h"
+
+/* MAXTHREADS is the largest --lex-threads tried */
+#define MAXTHREADS 64
+
+/* a token stream */
+typedef struct
+{
+  TokenSpan *tok;
+  size_t ntok, maxtok;
+} Stream;
+
+static const char *engineName[] = {"flex", "direct"};
+
+/* scan sb with engine on nthreads threads into s,
+ * comments included; sb is refilled from the pristine
+ * text first, since flex writes into its buffer.
+ * Returns FALSE if chunks were asked for but sb is
+ * too small to split into that many.
+ */
+static int scanStream(CompilerContext *ctx, SourceBuffer *sb, const char *text,
+                      ScanEngine engine, int nthreads, Stream *s)
+{
+  memcpy(sb->text, text, sb->len);
+  resetContext(ctx);
+  ctx->source = sb;
+  ctx->scanEngine = engine;
+  ctx->lexThreads = nthreads;
+  scanInit(ctx);
+  if (nthreads > 1 && ctx->chunks == NULL)
+  {
+    scanRelease(ctx);
+    return FALSE;
+  }
+  s->ntok = 0;
+  do
+  {
+    if (s->ntok == s->maxtok)
+    {
+      s->maxtok = s->maxtok ? s->maxtok * 2 : 1024;
+      s->tok = (TokenSpan *)realloc(s->tok, s->maxtok * sizeof(TokenSpan));
+      if (s->tok == NULL)
+      {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+      }
+    }
+    getToken(ctx);
+    s->tok[s->ntok++] = ctx->tok;
+  } while (ctx->tok.kind != ENDFILE);
+  scanRelease(ctx);
+  return TRUE;
+}
+
+/* TRUE if a and b are the same token; where the
+ * engines put ENDFILE does not matter
+ */
+static int sameToken(TokenSpan *a, TokenSpan *b)
+{
+  return a->kind == b->kind &&
+         (a->kind == ENDFILE || (a->offset == b->offset && a->len == b->len));
+}
+
+/* compare s against the reference stream ref; prints
+ * the first difference and returns FALSE if they differ
+ */
+static int sameStream(const char *file, const char *what, Stream *ref, Stream *s)
+{
+  size_t i;
+  for (i = 0; i < ref->ntok && i < s->ntok; i++)
+    if (!sameToken(&ref->tok[i], &s->tok[i]))
+    {
+      fprintf(stderr, "%s: %s: token %lu is %d at %lu+%d, flex has %d at %lu+%d\n",
+              file, what, (unsigned long)i, s->tok[i].kind,
+              (unsigned long)s->tok[i].offset, s->tok[i].len, ref->tok[i].kind,
+              (unsigned long)ref->tok[i].offset, ref->tok[i].len);
+      return FALSE;
+    }
+  if (ref->ntok != s->ntok)
+  {
+    fprintf(stderr, "%s: %s: %lu tokens, flex has %lu\n", file, what,
+            (unsigned long)s->ntok, (unsigned long)ref->ntok);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+int main(int argc, char *argv[])
+{
+  CompilerContext context, *ctx = &context;
+  Stream ref = {NULL, 0, 0}, s = {NULL, 0, 0};
+  int i, e, n, nfailed = 0;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s <filename>...\n", argv[0]);
+    return 1;
+  }
+  initContext(ctx);
+  for (i = 1; i < argc; i++)
+  {
+    SourceBuffer sb;
+    char *text;
+    int ok = TRUE, nsplit = 0;
+    if (!openSource(&sb, argv[i]))
+    {
+      fprintf(stderr, "cannot read %s\n", argv[i]);
+      return 1;
+    }
+    text = (char *)malloc(sb.len + 1);
+    memcpy(text, sb.text, sb.len);
+
+    /* the reference: sequential flex */
+    scanStream(ctx, &sb, text, ScanFlex, 1, &ref);
+    scanStream(ctx, &sb, text, ScanDirect, 1, &s);
+    ok = sameStream(argv[i], "direct", &ref, &s);
+    for (e = ScanFlex; e <= ScanDirect; e++)
+      for (n = 2; n <= MAXTHREADS && ok; n++)
+      {
+        char what[64];
+        if (!scanStream(ctx, &sb, text, (ScanEngine)e, n, &s))
+          break;
+        sprintf(what, "%s on %d threads", engineName[e], n);
+        ok = sameStream(argv[i], what, &ref, &s);
+        nsplit++;
+      }
+    printf("%-32s %8lu tokens %4d parallel runs %s\n", argv[i], (unsigned long)ref.ntok,
+           nsplit, ok ? "ok" : "FAILED");
+    if (!ok)
+      nfailed++;
+    free(text);
+    closeSource(&sb);
+  }
+  free(ref.tok);
+  free(s.tok);
+  freeContext(ctx);
+  return nfailed ? 1 : 0;
+}
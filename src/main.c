@@ -6,16 +6,10 @@
 /****************************************************/
 
 #include "globals.h"
-
-/* set NO_PARSE to TRUE to get a scanner-only compiler */
-#define NO_PARSE FALSE
-/* set NO_ANALYZE to TRUE to get a parser-only compiler */
-#define NO_ANALYZE TRUE
-
-/* set NO_CODE to TRUE to get a compiler that does not
- * generate code
- */
-#define NO_CODE FALSE
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
 
 /**
  * [HW1] Jiho Rhee
@@ -23,127 +17,581 @@
 #define RESULT_FILE_LIST "result_file_list.txt"
 #define FILE_OUT_SUFFIX "_20161250.txt"
 
+/* MAXJOBS is the maximum number of worker threads in batch mode */
+#define MAXJOBS 256
+
 #include "util.h"
-#if NO_PARSE
 #include "scan.h"
-#else
+#include "source.h"
+#include "compile.h"
+#include "server.h"
+#include "cache.h"
+#include "timing.h"
+#include "memstat.h"
+#include "outbuf.h"
 #include "parse.h"
-#if !NO_ANALYZE
-#include "analyze.h"
-#if !NO_CODE
-#include "cgen.h"
-#endif
-#endif
-#endif
-
-/* allocate global variables */
-int lineno = 0;
-FILE *source;
-FILE *listing;
-FILE *code;
-
-/* allocate and set tracing flags */
-int EchoSource = FALSE;
-int TraceScan = FALSE;
-int TraceParse = TRUE;
-int TraceAnalyze = FALSE;
-int TraceCode = FALSE;
-
-int Error = FALSE;
 
-int main(int argc, char *argv[])
+/**
+ * Batch mode.
+ * Source files are handed out to worker threads one at a time.
+ * Every worker keeps one CompilerContext (and its scanner) for all
+ * of its files, so the workers only share the job list and
+ * result_file_list.txt.
+ */
+static FILE *result_file_list;
+static pthread_mutex_t resultListLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t jobLock = PTHREAD_MUTEX_INITIALIZER;
+
+static char **jobs;   /* source file names */
+static int njobs;     /* number of source files */
+static int maxjobs;   /* allocated size of jobs */
+static int nextJob;   /* index of the next file to compile */
+static int nfailed;   /* number of files which failed to compile */
+
+/* --stdout: listings go to standard output instead
+ * of <pgm>_20161250.txt, one whole listing at a time
+ */
+static int toStdout = FALSE;
+static pthread_mutex_t stdoutLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* --syntax-only: only check that the files parse */
+static int syntaxOnly = FALSE;
+
+/* --scanner: the scanner engine of every worker */
+static ScanEngine scanEngine = ScanFlex;
+
+/* --parser: the parser of every worker */
+static ParserEngine parserEngine = ParseRd;
+
+/* --pipeline: scan each file on a thread of its own */
+static int pipelineScan = FALSE;
+
+/* --lex-threads: lex large files in that many chunks at once */
+static int lexThreads = 1;
+
+/* --compact-ast: print trees from their compact form */
+static int compactAst = FALSE;
+
+/* --max-errors: syntax errors reported per file; 0: all of them */
+static int maxErrors = 1;
+
+/* --emit-tokens=bin: write each file's tokens to <file>.tok
+ * instead of compiling it; --read-tokens: parse from <file>.tok
+ * when it was written from the same source
+ */
+static int emitTokens = FALSE;
+static int readTokens = FALSE;
+
+/* compilation cache (--cache), or NULL */
+static CompileCache *cache;
+
+/* per-worker timing records (--time-report, --trace-out), or NULL */
+static Timing *timings;
+
+/* per-worker allocation counters (--mem-report), or NULL */
+static MemStat *memstats;
+
+/* write len bytes of data to the file fname */
+static int writeOutput(const char *fname, const char *data, size_t len)
 {
-  TreeNode *syntaxTree;
-  char pgm[120]; /* source code file name */
-  if (argc != 2)
+  FILE *f = fopen(fname, "w");
+  if (f == NULL)
   {
-    fprintf(stderr, "usage: %s <filename>\n", argv[0]);
-    exit(1);
+    fprintf(stderr, "fopen(%s) failed.\n", fname);
+    return FALSE;
+  }
+  fwrite(data, 1, len, f);
+  fclose(f);
+  return TRUE;
+}
+
+/* TOKFILESIZE is the size of a token file name */
+#define TOKFILESIZE (MAXNAME + sizeof(".tok"))
+
+/* the token file name of pgm: pgm less the extension of
+ * its last component, plus .tok. Returns FALSE if it does
+ * not fit in buf.
+ */
+static int tokenFileName(char *buf, size_t size, const char *pgm)
+{
+  return snprintf(buf, size, "%.*s.tok", nameStem(pgm), pgm) < (int)size;
+}
+
+/* start scanning ctx->source for pgm: from its token
+ * file with --read-tokens if that is up to date
+ */
+static void startScan(CompilerContext *ctx, const char *pgm)
+{
+  if (readTokens)
+  {
+    char tokfile[TOKFILESIZE];
+    if (tokenFileName(tokfile, sizeof(tokfile), pgm))
+      openTokenFile(ctx, tokfile);
   }
-  strcpy(pgm, argv[1]);
-  if (strchr(pgm, '.') == NULL)
-    strcat(pgm, ".tny");
-  source = fopen(pgm, "r");
-  if (source == NULL)
+  scanInit(ctx);
+}
+
+/* write the tokens of src to pgm's token file.
+ * returns FALSE if it could not be written.
+ */
+static int emitTokenFile(CompilerContext *ctx, SourceBuffer *src, const char *pgm)
+{
+  char tokfile[TOKFILESIZE];
+  int ok;
+
+  if (!tokenFileName(tokfile, sizeof(tokfile), pgm))
+  {
+    fprintf(stderr, "Token file name too long: %s\n", pgm);
+    closeSource(src);
+    return FALSE;
+  }
+  resetContext(ctx);
+  ctx->source = src;
+  scanInit(ctx);
+  ok = writeTokenFile(ctx, tokfile);
+  scanRelease(ctx);
+  closeSource(src);
+  if (ok)
+    printf("token file written: %s\n", tokfile);
+  return ok;
+}
+
+/* compile src through the cache: a hit skips every
+ * phase and writes the stored listing and code.
+ * returns FALSE if the file could not be compiled.
+ */
+static int compileCached(CompilerContext *ctx, SourceBuffer *src,
+                         const char *pgm, const char *codefile,
+                         const char *fout_name)
+{
+  CacheKey key;
+  CminusResult result;
+  int ok;
+
+  /* hash before scanning: flex writes into the buffer */
+  cacheKey(key, src->text, src->len, pgm, compileFlags(ctx));
+  if (!cacheLookup(cache, key, &result))
+  {
+    if (compileToMemory(ctx, src, pgm, &result) != 0)
+    {
+      fprintf(stderr, "out of memory compiling %s\n", pgm);
+      closeSource(src);
+      return FALSE;
+    }
+    cacheStore(cache, key, &result);
+  }
+  closeSource(src);
+
+  if (toStdout)
+  {
+    pthread_mutex_lock(&stdoutLock);
+    ok = fwrite(result.listing, 1, result.listingLen, stdout) == result.listingLen;
+    fflush(stdout);
+    pthread_mutex_unlock(&stdoutLock);
+  }
+  else
+  {
+    ok = writeOutput(fout_name, result.listing, result.listingLen);
+    if (ok)
+      printf("result file written: %s\n", fout_name);
+  }
+  if (result.codeLen > 0)
+    ok = writeOutput(codefile, result.code, result.codeLen) && ok;
+  ok = ok && !result.error;
+  cminusFreeResult(&result);
+  return ok;
+}
+
+/* check src with recognize(): no tree and no listing.
+ * the first syntax error is reported on stderr.
+ * returns FALSE if src does not parse.
+ */
+static int checkSyntax(CompilerContext *ctx, SourceBuffer *src, const char *pgm)
+{
+  int line;
+
+  resetContext(ctx);
+  ctx->source = src;
+  startScan(ctx, pgm);
+  phaseBegin(ctx, PhaseParse);
+  line = recognize(ctx);
+  phaseEnd(ctx, PhaseParse);
+  if (line != 0)
+  {
+    /* report where the offending token starts */
+    int col = columnOf(src, ctx->tok.offset);
+    line = lineOf(src, ctx->tok.offset);
+    if (ctx->token == ENDFILE)
+      fprintf(stderr, "%s:%d:%d: syntax error at end of file\n", pgm, line, col);
+    else
+      fprintf(stderr, "%s:%d:%d: syntax error at '%s'\n", pgm, line, col, tokenText(ctx));
+  }
+  scanRelease(ctx);
+  closeSource(src);
+  return line == 0;
+}
+
+/* compile pgm & write its listing to <pgm>_20161250.txt.
+ * returns FALSE if the file could not be compiled.
+ */
+static int compileFile(CompilerContext *ctx, const char *filename)
+{
+  char pgm[MAXNAME + 1];      /* source code file name */
+  char codefile[MAXNAME + 4]; /* TM code file name */
+  char fout_name[MAXNAME + sizeof(FILE_OUT_SUFFIX)]; /* listing file name */
+  SourceBuffer src;
+  OutBuf lst;
+  int fd = -1;
+  int ok;
+
+  if (snprintf(pgm, sizeof(pgm), filename[nameStem(filename)] ? "%s" : "%s.tny",
+               filename) >= (int)sizeof(pgm))
+  {
+    fprintf(stderr, "File name too long: %s\n", filename);
+    return FALSE;
+  }
+  if (!openSource(&src, pgm))
   {
     fprintf(stderr, "File %s not found\n", pgm);
-    exit(1);
+    return FALSE;
   }
 
+  if (emitTokens)
+    return emitTokenFile(ctx, &src, pgm);
+  if (syntaxOnly)
+    return checkSyntax(ctx, &src, pgm);
+
+  snprintf(codefile, sizeof(codefile), "%.*s.tm", nameStem(pgm), pgm);
+
   /* [HW1] Parse file name & get output file name */
-  FILE *result_file_list = fopen(RESULT_FILE_LIST, "a");
-  if (result_file_list == NULL)
+  snprintf(fout_name, sizeof(fout_name), "%.*s%s", nameStem(pgm), pgm, FILE_OUT_SUFFIX);
+
+  /* Write output file name to result_file_list.txt */
+  if (!toStdout)
   {
-    fprintf(stderr, "fopen(%s) failed.\n", RESULT_FILE_LIST);
-    exit(1);
+    pthread_mutex_lock(&resultListLock);
+    fprintf(result_file_list, "%s\n", fout_name);
+    pthread_mutex_unlock(&resultListLock);
   }
 
-  char filename_copy[128], *fout_name, *ptr_dummy;
-  strcpy(filename_copy, pgm);
-  fout_name = strtok_r(filename_copy, ".", &ptr_dummy);
-  strcat(fout_name, FILE_OUT_SUFFIX);
+  if (cache != NULL)
+    return compileCached(ctx, &src, pgm, codefile, fout_name);
 
-  /* Write output file name to result_file_list.txt */
-  fprintf(result_file_list, "%s\n", fout_name);
+  if (!toStdout)
+  {
+    fd = open(fout_name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+    {
+      fprintf(stderr, "fopen(%s) failed.\n", fout_name);
+      closeSource(&src);
+      return FALSE;
+    }
+  }
+  /* a --stdout listing is kept in memory until it is complete */
+  outInit(&lst, fd);
+
+  resetContext(ctx);
+  ctx->source = &src;
+  ctx->listing = &lst;
+  startScan(ctx, pgm);
 
-  listing = fopen(fout_name, "w"); /* send listing to screen */
-  if (listing == NULL)
+  if (!toStdout)
+    printf("result file written: %s\n", fout_name);
+  compile(ctx, pgm, codefile);
+  ok = !ctx->Error;
+  scanRelease(ctx);
+  ctx->listing = NULL;
+
+  if (toStdout)
   {
-    fprintf(stderr, "fopen(%s) failed.\n", fout_name);
-    exit(1);
+    pthread_mutex_lock(&stdoutLock);
+    fflush(stdout);
+    lst.fd = STDOUT_FILENO;
+    outFlush(&lst);
+    pthread_mutex_unlock(&stdoutLock);
+  }
+  else
+  {
+    outFlush(&lst);
+    close(fd);
+  }
+  if (lst.error)
+  {
+    fprintf(stderr, "cannot write the listing of %s\n", pgm);
+    ok = FALSE;
+  }
+  outFree(&lst);
+  closeSource(&src);
+  return ok;
+}
+
+/* worker thread: compile files until the job list is exhausted */
+static void *worker(void *arg)
+{
+  CompilerContext context, *ctx = &context;
+  initContext(ctx);
+  ctx->scanEngine = scanEngine;
+  ctx->parserEngine = parserEngine;
+  ctx->pipelineScan = pipelineScan;
+  ctx->lexThreads = lexThreads;
+  ctx->compactAst = compactAst;
+  ctx->maxErrors = maxErrors;
+  if (timings != NULL)
+    ctx->timing = &timings[(intptr_t)arg];
+  if (memstats != NULL)
+    ctx->memstat = &memstats[(intptr_t)arg];
+  for (;;)
+  {
+    int i;
+    pthread_mutex_lock(&jobLock);
+    i = nextJob++;
+    pthread_mutex_unlock(&jobLock);
+    if (i >= njobs)
+      break;
+    if (!compileFile(ctx, jobs[i]))
+    {
+      pthread_mutex_lock(&jobLock);
+      nfailed++;
+      pthread_mutex_unlock(&jobLock);
+    }
+  }
+  freeContext(ctx);
+  return NULL;
+}
+
+/* append a source file name to jobs */
+static void addJob(char *filename)
+{
+  if (njobs == maxjobs)
+  {
+    maxjobs = maxjobs ? maxjobs * 2 : 64;
+    jobs = (char **)realloc(jobs, maxjobs * sizeof(char *));
+  }
+  jobs[njobs++] = filename;
+}
+
+/* append every non-empty line of listfile to jobs */
+static int readFileList(const char *listfile)
+{
+  char line[MAXNAME + 3]; /* a name, CR, LF */
+  FILE *f = fopen(listfile, "r");
+  if (f == NULL)
+  {
+    fprintf(stderr, "File %s not found\n", listfile);
+    return FALSE;
+  }
+  while (fgets(line, sizeof(line), f))
+  {
+    size_t len = strcspn(line, "\r\n");
+    if (line[len] == '\0' && !feof(f))
+    {
+      /* no end of line in sight: the name is too long */
+      fprintf(stderr, "File name too long in %s: %.40s...\n", listfile, line);
+      fclose(f);
+      return FALSE;
+    }
+    line[len] = '\0';
+    if (line[0] == '\0')
+      continue;
+    addJob(strdup(line));
   }
+  fclose(f);
+  return TRUE;
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s <filename>\n", prog);
+  fprintf(stderr, "       %s [-j jobs] [-l filelist] <filename>...\n", prog);
+  fprintf(stderr, "       %s [-j threads] --server [socket]\n", prog);
+  fprintf(stderr, "options: --cache <dir> [--cache-size <MB>]\n");
+  fprintf(stderr, "         --time-report --trace-out <file.json> --mem-report\n");
+  fprintf(stderr, "         --stdout (write listings to standard output)\n");
+  fprintf(stderr, "         --syntax-only (only report the first syntax error)\n");
+  fprintf(stderr, "         --scanner=flex|direct (default flex)\n");
+  fprintf(stderr, "         --parser=rd|lalr (default rd, recursive descent)\n");
+  fprintf(stderr, "         --pipeline (scan on a separate thread while parsing)\n");
+  fprintf(stderr, "         --lex-threads <n> (lex large files on n threads)\n");
+  fprintf(stderr, "         --compact-ast (print the syntax tree from its compact form)\n");
+  fprintf(stderr, "         --max-errors <n> (report up to n syntax errors per file, 0: all; default 1)\n");
+  fprintf(stderr, "         --emit-tokens=bin (write tokens to <file>.tok, don't compile)\n");
+  fprintf(stderr, "         --read-tokens (take tokens from an up-to-date <file>.tok)\n");
+  exit(1);
+}
 
-  fprintf(listing, "\nC- COMPILATION: %s\n", pgm);
-#if NO_PARSE
-  fprintf(listing, "%-20s%-20s%s\n", "line number", "token", "lexeme");
-  fprintf(listing, "================================================================================\n");
-  TokenType tokenType;
-  while ((tokenType = getToken()) != ENDFILE)
-    printToken(tokenType, tokenString);
-  if (tokenType == ENDFILE) /* print EOF */
-    printToken(tokenType, tokenString);
-
-#else
-  printf("result file written: %s\n", fout_name);
-  syntaxTree = parse();
-  if (TraceParse)
-  {
-    fprintf(listing, "\nSyntax tree:\n");
-    printTree(syntaxTree);
-  }
-#if !NO_ANALYZE
-  if (!Error)
-  {
-    if (TraceAnalyze)
-      fprintf(listing, "\nBuilding Symbol Table...\n");
-    buildSymtab(syntaxTree);
-    if (TraceAnalyze)
-      fprintf(listing, "\nChecking Types...\n");
-    typeCheck(syntaxTree);
-    if (TraceAnalyze)
-      fprintf(listing, "\nType Checking Finished\n");
-  }
-#if !NO_CODE
-  if (!Error)
-  {
-    char *codefile;
-    int fnlen = strcspn(pgm, ".");
-    codefile = (char *)calloc(fnlen + 4, sizeof(char));
-    strncpy(codefile, pgm, fnlen);
-    strcat(codefile, ".tm");
-    code = fopen(codefile, "w");
-    if (code == NULL)
+int main(int argc, char *argv[])
+{
+  int njobsThreads = 1;
+  int batch = FALSE;
+  const char *serverSocket = NULL;
+  char defaultPath[MAXSOCKETPATH];
+  const char *cacheDir = NULL;
+  size_t cacheSize = CACHE_DEFAULT_SIZE;
+  CompileCache compileCache;
+  int timeReport = FALSE;
+  const char *traceOut = NULL;
+  int memReport = FALSE;
+  int i;
+
+  for (i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
     {
-      printf("Unable to open %s\n", codefile);
+      njobsThreads = atoi(argv[++i]);
+      if (njobsThreads < 1 || njobsThreads > MAXJOBS)
+        usage(argv[0]);
+      batch = TRUE;
+    }
+    else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+    {
+      if (!readFileList(argv[++i]))
+        exit(1);
+      batch = TRUE;
+    }
+    else if (strcmp(argv[i], "--server") == 0)
+    {
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        serverSocket = argv[++i];
+      else if (defaultSocket(defaultPath, sizeof(defaultPath), TRUE))
+        serverSocket = defaultPath;
+      else
+        exit(1);
+    }
+    else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+      cacheDir = argv[++i];
+    else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc)
+    {
+      long mb = atol(argv[++i]);
+      if (mb < 1)
+        usage(argv[0]);
+      cacheSize = (size_t)mb * 1024 * 1024;
+    }
+    else if (strcmp(argv[i], "--time-report") == 0)
+      timeReport = TRUE;
+    else if (strcmp(argv[i], "--trace-out") == 0 && i + 1 < argc)
+      traceOut = argv[++i];
+    else if (strcmp(argv[i], "--mem-report") == 0)
+      memReport = TRUE;
+    else if (strcmp(argv[i], "--stdout") == 0)
+      toStdout = TRUE;
+    else if (strcmp(argv[i], "--syntax-only") == 0)
+      syntaxOnly = TRUE;
+    else if (strcmp(argv[i], "--scanner=flex") == 0)
+      scanEngine = ScanFlex;
+    else if (strcmp(argv[i], "--scanner=direct") == 0)
+      scanEngine = ScanDirect;
+    else if (strcmp(argv[i], "--parser=rd") == 0)
+      parserEngine = ParseRd;
+    else if (strcmp(argv[i], "--parser=lalr") == 0)
+      parserEngine = ParseLalr;
+    else if (strcmp(argv[i], "--pipeline") == 0)
+      pipelineScan = TRUE;
+    else if (strcmp(argv[i], "--compact-ast") == 0)
+      compactAst = TRUE;
+    else if (strcmp(argv[i], "--emit-tokens=bin") == 0)
+      emitTokens = TRUE;
+    else if (strcmp(argv[i], "--read-tokens") == 0)
+      readTokens = TRUE;
+    else if (strcmp(argv[i], "--lex-threads") == 0 && i + 1 < argc)
+    {
+      lexThreads = atoi(argv[++i]);
+      if (lexThreads < 1)
+        usage(argv[0]);
+    }
+    else if (strcmp(argv[i], "--max-errors") == 0 && i + 1 < argc)
+    {
+      maxErrors = atoi(argv[++i]);
+      if (maxErrors < 0)
+        usage(argv[0]);
+    }
+    else if (argv[i][0] == '-')
+      usage(argv[0]);
+    else
+      addJob(argv[i]);
+  }
+  if (serverSocket == NULL && njobs == 0)
+    usage(argv[0]);
+  if (cacheDir != NULL)
+  {
+    if (!cacheOpen(&compileCache, cacheDir, cacheSize))
+    {
+      fprintf(stderr, "cannot use cache directory %s\n", cacheDir);
       exit(1);
     }
-    codeGen(syntaxTree, codefile);
-    fclose(code);
+    cache = &compileCache;
+  }
+  if (serverSocket != NULL)
+    return runServer(serverSocket, njobsThreads, cache) ? 0 : 1;
+  if (njobs > 1)
+    batch = TRUE;
+
+  result_file_list = fopen(RESULT_FILE_LIST, "a");
+  if (result_file_list == NULL)
+  {
+    fprintf(stderr, "fopen(%s) failed.\n", RESULT_FILE_LIST);
+    exit(1);
+  }
+
+  if (!batch)
+    njobsThreads = 1;
+  else if (njobsThreads > njobs)
+    njobsThreads = njobs;
+  if (timeReport || traceOut != NULL)
+  {
+    timings = (Timing *)malloc(njobsThreads * sizeof(Timing));
+    for (i = 0; i < njobsThreads; i++)
+      timingInit(&timings[i], i, traceOut != NULL);
+  }
+  if (memReport)
+  {
+    memstats = (MemStat *)malloc(njobsThreads * sizeof(MemStat));
+    for (i = 0; i < njobsThreads; i++)
+      memStatInit(&memstats[i]);
+  }
+
+  if (!batch)
+  {
+    worker((void *)0);
+  }
+  else
+  {
+    pthread_t threads[MAXJOBS];
+    struct timespec start, end;
+    double elapsed;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < njobsThreads; i++)
+      pthread_create(&threads[i], NULL, worker, (void *)(intptr_t)i);
+    for (i = 0; i < njobsThreads; i++)
+      pthread_join(threads[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("batch: %d files (%d failed) on %d threads in %.3f s, %.1f files/sec\n",
+           njobs, nfailed, njobsThreads, elapsed,
+           elapsed > 0 ? njobs / elapsed : 0.0);
+  }
+
+  if (timings != NULL)
+  {
+    if (timeReport)
+      printTimeReport(stdout, timings, njobsThreads);
+    if (traceOut != NULL && !writeTrace(traceOut, timings, njobsThreads))
+      fprintf(stderr, "cannot write %s\n", traceOut);
+    for (i = 0; i < njobsThreads; i++)
+      timingFree(&timings[i]);
+    free(timings);
+  }
+  if (memstats != NULL)
+  {
+    printMemReport(stdout, memstats, njobsThreads);
+    free(memstats);
+  }
+  if (cache != NULL)
+  {
+    cachePrintStats(cache, stdout);
+    cacheClose(cache);
   }
-#endif
-#endif
-#endif
-  fclose(source);
   fclose(result_file_list);
-  return 0;
+  return nfailed ? -1 : 0;
 }
@@ -0,0 +1,118 @@
+/****************************************************/
+/* File: memstat.c                                  */
+/* Allocation accounting per phase and allocation   */
+/* site, and peak RSS                               */
+/****************************************************/
+
+#include "globals.h"
+#include "memstat.h"
+#include <sys/resource.h>
+
+static const char *siteNames[NSITES] = {
+    "StmtK nodes", "ExpK nodes", "TypeK nodes", "ArrSizeK nodes",
+    "strings", "symbol records", "line records", "compact tree"};
+
+static const char *phaseNames[NPHASES + 1] = {
+    "scan", "parse", "printTree", "analyze", "codeGen", "(none)"};
+
+static const char *stmtKindNames[] = {
+    "IfK", "ElseK", "AssignK", "CompoundK", "WhileK", "ReturnK",
+    "VarDeclK", "ArrayDeclK", "FuncDeclK"};
+
+static const char *expKindNames[] = {
+    "OpK", "ConstK", "IdK", "VarCallK", "ArrayCallK", "FuncCallK",
+    "ParamListK", "ParamK", "ArgK", "SimpleExpK", "AddExpK", "TermK",
+    "ArrayIndexK"};
+
+#define NSTMTKINDS (int)(sizeof(stmtKindNames) / sizeof(stmtKindNames[0]))
+#define NEXPKINDS (int)(sizeof(expKindNames) / sizeof(expKindNames[0]))
+
+void memStatInit(MemStat *m)
+{
+  memset(m, 0, sizeof(MemStat));
+  m->phase = NPHASES;
+}
+
+void countAlloc(CompilerContext *ctx, size_t size, AllocSite site, int kind)
+{
+  MemStat *m = ctx->memstat;
+  if (m != NULL)
+  {
+    m->count[site]++;
+    m->bytes[site] += size;
+    m->phaseCount[m->phase]++;
+    m->phaseBytes[m->phase] += size;
+    if (kind >= 0 && kind < MAXKIND)
+    {
+      if (site == SiteStmtNode)
+        m->stmtKind[kind]++;
+      else if (site == SiteExpNode)
+        m->expKind[kind]++;
+    }
+  }
+}
+
+void *countedAlloc(CompilerContext *ctx, size_t size, AllocSite site, int kind)
+{
+  countAlloc(ctx, size, site, kind);
+  return malloc(size);
+}
+
+void printMemReport(FILE *out, MemStat *m, int n)
+{
+  MemStat sum;
+  struct rusage ru;
+  long count = 0;
+  size_t bytes = 0;
+  int i, k;
+
+  memStatInit(&sum);
+  for (i = 0; i < n; i++)
+  {
+    for (k = 0; k < NSITES; k++)
+    {
+      sum.count[k] += m[i].count[k];
+      sum.bytes[k] += m[i].bytes[k];
+    }
+    for (k = 0; k < MAXKIND; k++)
+    {
+      sum.stmtKind[k] += m[i].stmtKind[k];
+      sum.expKind[k] += m[i].expKind[k];
+    }
+    for (k = 0; k <= NPHASES; k++)
+    {
+      sum.phaseCount[k] += m[i].phaseCount[k];
+      sum.phaseBytes[k] += m[i].phaseBytes[k];
+    }
+  }
+
+  fprintf(out, "%-20s%12s%14s\n", "allocation site", "count", "bytes");
+  for (k = 0; k < NSITES; k++)
+  {
+    fprintf(out, "%-20s%12ld%14zu\n", siteNames[k], sum.count[k], sum.bytes[k]);
+    count += sum.count[k];
+    bytes += sum.bytes[k];
+    if (k == SiteStmtNode)
+    {
+      for (i = 0; i < NSTMTKINDS; i++)
+        if (sum.stmtKind[i] > 0)
+          fprintf(out, "  %-18s%12ld\n", stmtKindNames[i], sum.stmtKind[i]);
+    }
+    else if (k == SiteExpNode)
+    {
+      for (i = 0; i < NEXPKINDS; i++)
+        if (sum.expKind[i] > 0)
+          fprintf(out, "  %-18s%12ld\n", expKindNames[i], sum.expKind[i]);
+    }
+  }
+  fprintf(out, "%-20s%12ld%14zu\n", "total", count, bytes);
+
+  fprintf(out, "\n%-20s%12s%14s\n", "phase", "count", "bytes");
+  for (k = 0; k <= NPHASES; k++)
+    if (sum.phaseCount[k] > 0)
+      fprintf(out, "%-20s%12ld%14zu\n", phaseNames[k], sum.phaseCount[k],
+              sum.phaseBytes[k]);
+
+  if (getrusage(RUSAGE_SELF, &ru) == 0)
+    fprintf(out, "\npeak RSS: %ld KiB\n", ru.ru_maxrss);
+}
@@ -0,0 +1,63 @@
+/****************************************************/
+/* File: memstat.h                                  */
+/* Allocation accounting per phase and allocation   */
+/* site, and peak RSS (--mem-report)                */
+/****************************************************/
+
+#ifndef _MEMSTAT_H_
+#define _MEMSTAT_H_
+
+#include "timing.h"
+
+/* where an allocation is made */
+typedef enum
+{
+   SiteStmtNode,    /* newStmtNode */
+   SiteExpNode,     /* newExpNode and its wrappers */
+   SiteTypeNode,    /* newTypeNode */
+   SiteArrSizeNode, /* newArrSizeNode */
+   SiteString,      /* copyString and interned names */
+   SiteSymbol,      /* st_insert: bucket record */
+   SiteLine,        /* st_insert: line list record */
+   SiteCompactTree, /* compactTree */
+   NSITES
+} AllocSite;
+
+/* MAXKIND bounds the StmtKind and ExpKind values */
+#define MAXKIND 32
+
+/* The allocation counters of one thread. A context
+ * points to it through ctx->memstat.
+ */
+typedef struct memStat
+{
+   int phase; /* Phase running now; NPHASES outside any phase */
+   long count[NSITES];
+   size_t bytes[NSITES];
+   long stmtKind[MAXKIND]; /* SiteStmtNode by StmtKind */
+   long expKind[MAXKIND];  /* SiteExpNode by ExpKind */
+   long phaseCount[NPHASES + 1];
+   size_t phaseBytes[NPHASES + 1];
+} MemStat;
+
+/* Procedure memStatInit clears m */
+void memStatInit(MemStat *m);
+
+/* Procedure countAlloc counts an allocation of
+ * size bytes for site in ctx->memstat if there is
+ * one. kind is the StmtKind or ExpKind of a node,
+ * otherwise 0.
+ */
+void countAlloc(CompilerContext *ctx, size_t size, AllocSite site, int kind);
+
+/* Function countedAlloc allocates size bytes for
+ * site with malloc, counting them as countAlloc does
+ */
+void *countedAlloc(CompilerContext *ctx, size_t size, AllocSite site, int kind);
+
+/* Procedure printMemReport prints the counters of
+ * the n records in m and the peak RSS of the process
+ */
+void printMemReport(FILE *out, MemStat *m, int n);
+
+#endif
@@ -0,0 +1,193 @@
+/****************************************************/
+/* File: outbuf.c                                   */
+/* Buffered listing output                          */
+/****************************************************/
+
+#include "globals.h"
+#include "outbuf.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+/* initial size of a buffer */
+#define OUTBUF_INIT (64 * 1024)
+
+/* outIndent copies from here instead of looping */
+#define MAXSPACES 128
+static const char spaces[MAXSPACES + 1] =
+    "                                                                "
+    "                                                                ";
+
+void outInit(OutBuf *o, int fd)
+{
+  o->buf = NULL;
+  o->len = o->cap = 0;
+  o->fd = fd;
+  o->error = FALSE;
+}
+
+/* make room for n more bytes and the terminating NUL */
+static int reserve(OutBuf *o, size_t n)
+{
+  size_t cap;
+  char *buf;
+
+  if (o->len + n < o->cap)
+    return TRUE;
+  if (o->fd >= 0 && o->len > 0 && o->len + n > OUTBUF_FLUSH)
+  {
+    outFlush(o);
+    if (o->len + n < o->cap)
+      return TRUE;
+  }
+  cap = o->cap ? o->cap : OUTBUF_INIT;
+  while (cap <= o->len + n)
+    cap *= 2;
+  buf = (char *)realloc(o->buf, cap);
+  if (buf == NULL)
+  {
+    o->error = TRUE;
+    return FALSE;
+  }
+  o->buf = buf;
+  o->cap = cap;
+  return TRUE;
+}
+
+void outWrite(OutBuf *o, const char *s, size_t n)
+{
+  if (!reserve(o, n))
+    return;
+  memcpy(o->buf + o->len, s, n);
+  o->len += n;
+}
+
+void outPuts(OutBuf *o, const char *s)
+{
+  outWrite(o, s, strlen(s));
+}
+
+void outChar(OutBuf *o, char c)
+{
+  if (!reserve(o, 1))
+    return;
+  o->buf[o->len++] = c;
+}
+
+void outLine(OutBuf *o, const char *prefix, const char *s)
+{
+  size_t n = strlen(prefix), m = strlen(s);
+  if (!reserve(o, n + m + 1))
+    return;
+  memcpy(o->buf + o->len, prefix, n);
+  memcpy(o->buf + o->len + n, s, m);
+  o->buf[o->len + n + m] = '\n';
+  o->len += n + m + 1;
+}
+
+/* format n into the end of buf[12]; returns its first digit */
+static char *formatInt(char *buf, int n)
+{
+  char *p = buf + 11;
+  unsigned u = n < 0 ? -(unsigned)n : (unsigned)n;
+  *p = '\0';
+  do
+    *--p = '0' + u % 10;
+  while ((u /= 10) != 0);
+  if (n < 0)
+    *--p = '-';
+  return p;
+}
+
+void outInt(OutBuf *o, int n)
+{
+  char buf[12];
+  outPuts(o, formatInt(buf, n));
+}
+
+void outIndent(OutBuf *o, int n)
+{
+  while (n > MAXSPACES)
+  {
+    outWrite(o, spaces, MAXSPACES);
+    n -= MAXSPACES;
+  }
+  if (n > 0)
+    outWrite(o, spaces, n);
+}
+
+void outPad(OutBuf *o, const char *s, int width)
+{
+  int n = strlen(s);
+  outWrite(o, s, n);
+  outIndent(o, width - n);
+}
+
+void outIntPad(OutBuf *o, int n, int width)
+{
+  char buf[12];
+  outPad(o, formatInt(buf, n), width);
+}
+
+void outPrintf(OutBuf *o, const char *fmt, ...)
+{
+  va_list ap;
+  int n;
+  char small[256];
+
+  va_start(ap, fmt);
+  n = vsnprintf(small, sizeof(small), fmt, ap);
+  va_end(ap);
+  if (n < 0)
+    return;
+  if ((size_t)n < sizeof(small))
+  {
+    outWrite(o, small, n);
+    return;
+  }
+  if (!reserve(o, n))
+    return;
+  va_start(ap, fmt);
+  vsnprintf(o->buf + o->len, n + 1, fmt, ap);
+  va_end(ap);
+  o->len += n;
+}
+
+int outFlush(OutBuf *o)
+{
+  size_t done = 0;
+  if (o->fd < 0)
+    return !o->error;
+  while (done < o->len)
+  {
+    ssize_t n = write(o->fd, o->buf + done, o->len - done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+    {
+      o->error = TRUE;
+      break;
+    }
+    done += n;
+  }
+  o->len = 0;
+  return !o->error;
+}
+
+char *outDetach(OutBuf *o, size_t *len)
+{
+  char *s;
+  if (!reserve(o, 0))
+    return NULL;
+  o->buf[o->len] = '\0';
+  s = o->buf;
+  *len = o->len;
+  outInit(o, o->fd);
+  return s;
+}
+
+void outFree(OutBuf *o)
+{
+  free(o->buf);
+  outInit(o, o->fd);
+}
@@ -0,0 +1,74 @@
+/****************************************************/
+/* File: outbuf.h                                   */
+/* Buffered listing output: text is appended to a   */
+/* growable buffer and written with one write() at  */
+/* flush, or handed over as a string                */
+/****************************************************/
+
+#ifndef _OUTBUF_H_
+#define _OUTBUF_H_
+
+#include <stddef.h>
+
+/* OUTBUF_FLUSH is the buffered size above which an
+ * OutBuf with a file descriptor is flushed early,
+ * so huge listings do not stay in memory
+ */
+#define OUTBUF_FLUSH (8 * 1024 * 1024)
+
+typedef struct outBuf
+{
+   char *buf;  /* buffered text */
+   size_t len; /* bytes buffered */
+   size_t cap; /* bytes allocated at buf */
+   int fd;     /* flushed to fd; -1 keeps the text in memory */
+   int error;  /* TRUE after a failed allocation or write */
+} OutBuf;
+
+/* Procedure outInit prepares o to buffer text for
+ * fd, or for outDetach if fd is -1
+ */
+void outInit(OutBuf *o, int fd);
+
+/* Procedures outWrite, outPuts and outChar append
+ * n bytes, a string and a character to o
+ */
+void outWrite(OutBuf *o, const char *s, size_t n);
+void outPuts(OutBuf *o, const char *s);
+void outChar(OutBuf *o, char c);
+
+/* Procedure outLine appends prefix, s and a newline */
+void outLine(OutBuf *o, const char *prefix, const char *s);
+
+/* Procedure outInt appends n in decimal */
+void outInt(OutBuf *o, int n);
+
+/* Procedures outPad and outIntPad append s and n
+ * left-justified in width columns, like %-*s and %-*d
+ */
+void outPad(OutBuf *o, const char *s, int width);
+void outIntPad(OutBuf *o, int n, int width);
+
+/* Procedure outIndent appends n spaces */
+void outIndent(OutBuf *o, int n);
+
+/* Procedure outPrintf appends formatted text */
+void outPrintf(OutBuf *o, const char *fmt, ...);
+
+/* Function outFlush writes the buffered text to the
+ * file descriptor of o. Returns FALSE on error.
+ */
+int outFlush(OutBuf *o);
+
+/* Function outDetach returns the buffered text as
+ * a NUL terminated string owned by the caller, and
+ * its length in *len. o is left empty.
+ */
+char *outDetach(OutBuf *o, size_t *len);
+
+/* Procedure outFree releases the buffer of o
+ * without writing it
+ */
+void outFree(OutBuf *o);
+
+#endif
@@ -7,10 +7,10 @@
 
 #include "globals.h"
 #include "util.h"
+#include "outbuf.h"
 #include "scan.h"
 #include "parse.h"
-
-static TokenType token; /* holds current token */
+#include "timing.h"
 
 /**
  * [HW2] Jiho Rhee
@@ -47,37 +47,34 @@ static TokenType token; /* holds current token */
  * args → arg-list | empty
  * arg-list → arg-list , expression | expression
  */
-static TreeNode *declare_list(void);      /* declaration-list → declaration-list declaration | declaration */
-static TreeNode *declare(void);           /* declaration → var-declaration | fun-declaration */
-static TreeNode *var_declare(void);       /* var-declaration → type-specifier ID; | type-specifier ID [NUM]; */
-static ExpType type_spec(void);           /* type-specifier → int | void */
-static TreeNode *fun_declare(void);       /* fun-declaration → type-specifier ID ( params ) compound-stmt */
-static TreeNode *params(void);            /* params → param-list | void */
-static TreeNode *param_list(void);        /* param-list → param-list , param | param */
-static TreeNode *param(void);             /* param → type-specifier ID | type-specifier ID [ ] */
-static TreeNode *compound_stmt(void);     /* compound-stmt → { local-declarations statement-list } */
-static TreeNode *local_declare(void);     /* local-declarations → local-declarations var-declaration | empty */
-static TreeNode *stmt_list(void);         /* statement-list → statement-list statement | empty */
-static TreeNode *stmt(void);              /* statement → expression-stmt | compound-stmt | selection-stmt | iteration-stmt | return-stmt */
-static TreeNode *expr_stmt(void);         /* expression-stmt → expression ; | ; */
-static TreeNode *select_stmt(void);       /* selction-stmt → if ( expression ) statement | if ( expression ) statement else statement */
-static TreeNode *iter_stmt(void);         /* iteration-stmt → while ( expression ) statement */
-static TreeNode *return_stmt(void);       /* return-stmt → return ; | return expression ; */
-static TreeNode *expr(void);              /* expression → var = expression | simple-expression */
-static TreeNode *var(void);               /* var → ID | ID [ expression ] */
-static TreeNode *simple_expr(TreeNode *); /* simple-expression → additive-expression relop additive-expression | additive-expression */
-static TreeNode *add_expr(TreeNode *);    /* additive-expression → additive-expression addop term | term */
-static TreeNode *term(TreeNode *);        /* term → term mulop factor ( 수정: term → term mulop factor | factor ) */
-static TreeNode *factor(TreeNode *);      /* factor → ( expression ) | var | call | NUM */
-static TreeNode *relop(void);             /* relop → <= | < | >= | > | == | != */
-static TreeNode *addop(void);             /* addop → + | - */
-static TreeNode *mulop(void);             /* mulop → * | / */
-static TreeNode *call(void);              /* call → ID ( args ) */
-static TreeNode *args(void);              /* args → arg-list | empty */
-static TreeNode *arg_list(void);          /* arg-list → arg-list , expression | expression */
-
-/* consume COMMENT token & check next token */
-static int check(TokenType);
+static TreeNode *declare_list(CompilerContext *ctx);      /* declaration-list → declaration-list declaration | declaration */
+static TreeNode *declare(CompilerContext *ctx);           /* declaration → var-declaration | fun-declaration */
+static TreeNode *var_declare(CompilerContext *ctx);       /* var-declaration → type-specifier ID; | type-specifier ID [NUM]; */
+static ExpType type_spec(CompilerContext *ctx);           /* type-specifier → int | void */
+static TreeNode *fun_declare(CompilerContext *ctx);       /* fun-declaration → type-specifier ID ( params ) compound-stmt */
+static TreeNode *params(CompilerContext *ctx);            /* params → param-list | void */
+static TreeNode *param_list(CompilerContext *ctx);        /* param-list → param-list , param | param */
+static TreeNode *param(CompilerContext *ctx);             /* param → type-specifier ID | type-specifier ID [ ] */
+static TreeNode *compound_stmt(CompilerContext *ctx);     /* compound-stmt → { local-declarations statement-list } */
+static TreeNode *compound_body(CompilerContext *ctx, TreeNode *); /* compound_stmt() after {, recovering from errors */
+static TreeNode *local_declare(CompilerContext *ctx);     /* local-declarations → local-declarations var-declaration | empty */
+static TreeNode *stmt_list(CompilerContext *ctx);         /* statement-list → statement-list statement | empty */
+static TreeNode *stmt(CompilerContext *ctx);              /* statement → expression-stmt | compound-stmt | selection-stmt | iteration-stmt | return-stmt */
+static TreeNode *expr_stmt(CompilerContext *ctx);         /* expression-stmt → expression ; | ; */
+static TreeNode *select_stmt(CompilerContext *ctx);       /* selction-stmt → if ( expression ) statement | if ( expression ) statement else statement */
+static TreeNode *iter_stmt(CompilerContext *ctx);         /* iteration-stmt → while ( expression ) statement */
+static TreeNode *return_stmt(CompilerContext *ctx);       /* return-stmt → return ; | return expression ; */
+static TreeNode *expr(CompilerContext *ctx);              /* expression → var = expression | simple-expression */
+static TreeNode *var(CompilerContext *ctx);               /* var → ID | ID [ expression ] */
+static TreeNode *assign_expr(CompilerContext *ctx, TreeNode *); /* expression → var = expression, after var */
+static TreeNode *simple_expr(CompilerContext *ctx, TreeNode *); /* simple-expression, additive-expression and term by precedence */
+static TreeNode *factor(CompilerContext *ctx);            /* factor → ( expression ) | var | call | NUM */
+static TreeNode *call(CompilerContext *ctx);              /* call → ID ( args ) */
+static TreeNode *args(CompilerContext *ctx);              /* args → arg-list | empty */
+static TreeNode *arg_list(CompilerContext *ctx);          /* arg-list → arg-list , expression | expression */
+
+/* check next token */
+static int check(CompilerContext *ctx, TokenType);
 
 /* is the TreeNode a function declaration? */
 static int is_func_decl(TreeNode *);
@@ -86,49 +83,166 @@ static int is_func_decl(TreeNode *);
 static int is_func_call(TreeNode *);
 
 /* Parsing would be failed if syntax error occured. */
-static void fail(TokenType, const char *);
+static void fail(CompilerContext *ctx, TokenType, const char *);
 
-static void syntaxError(const char *message)
+static void syntaxError(CompilerContext *ctx, const char *message)
 {
-  fprintf(listing, "\n");
+  ctx->Error = TRUE;
+  ctx->syntaxErrors++;
+  if (ctx->listing == NULL) /* recognize() without a listing */
+    return;
+  outPrintf(ctx->listing, "\n");
   // fprintf(listing, ">>> Syntax error at line %d: %s\n", lineno, message);
-  fprintf(listing, ">>> Syntax error at line %d: \n    ", lineno);
-  fputs(message, listing);
-  fputs("\n", listing);
+  outPrintf(ctx->listing, ">>> Syntax error at line %d: \n    ", currentLine(ctx));
+  outPuts(ctx->listing, message);
+  outPuts(ctx->listing, "\n");
   // fprintf(listing, message);
   // vfprintf(listing, message, args);
-
-  Error = TRUE;
 }
 
-static void match(TokenType expected)
+static void match(CompilerContext *ctx, TokenType expected)
 {
-  if (check(expected))
-    token = getToken();
+  if (check(ctx, expected))
+    ctx->token = getToken(ctx);
   else
-    fail(expected, "match() failed.");
+    fail(ctx, expected, "match() failed.");
 }
 
-static void fail(TokenType expected, const char *message)
+static void fail(CompilerContext *ctx, TokenType expected, const char *message)
 {
-  syntaxError(message);
-  fprintf(listing, "    actual   : ");
-  printToken(token, tokenString);
-  fprintf(listing, "    expected : ");
-  printToken(expected, "");
+  syntaxError(ctx, message);
+  if (ctx->listing != NULL)
+  {
+    outPrintf(ctx->listing, "    actual   : ");
+    printToken(ctx, ctx->token, tokenText(ctx));
+    outPrintf(ctx->listing, "    expected : ");
+    printToken(ctx, expected, "");
+  }
 
-  exit(-1);
+  if (ctx->recover != NULL)
+    longjmp(*ctx->recover, 1);
+  longjmp(ctx->failJump, 1);
+}
+
+/**
+ * Panic-mode recovery. fail() jumps to the innermost
+ * recovery point, ctx->recover: declare_list() always has one,
+ * and each compound statement has its own unless ctx->maxErrors
+ * is 1, so the error-free path pays one setjmp() per parse by
+ * default. A recovery point skips the tokens of the broken
+ * declaration or statement and parsing goes on with the next
+ * one; whatever was built so far stays in the tree. Past
+ * ctx->maxErrors errors, or at the end of the file, the
+ * recovery points give up one after the other and parse()
+ * returns the partial tree.
+ */
+
+/* has parsing to stop? */
+static int stopped(CompilerContext *ctx)
+{
+  return ctx->token == ENDFILE ||
+         (ctx->maxErrors > 0 && ctx->syntaxErrors >= ctx->maxErrors);
+}
+
+/* hand the error on to the recovery point OUTER */
+static void giveUp(CompilerContext *ctx, jmp_buf *outer)
+{
+  ctx->recover = outer;
+  if (outer != NULL)
+    longjmp(*outer, 1);
+  longjmp(ctx->failJump, 1);
+}
+
+/* skip to the next declaration: past a ; or a } that closes a body,
+ * or up to INT or VOID; a { ... } block is skipped whole
+ */
+static void syncDeclare(CompilerContext *ctx)
+{
+  int depth = 0;
+  for (;;)
+  {
+    switch (ctx->token)
+    {
+    case ENDFILE:
+      return;
+    case INT:
+    case VOID:
+      if (depth == 0)
+        return;
+      break;
+    case SEMI:
+      if (depth == 0)
+      {
+        ctx->token = getToken(ctx);
+        return;
+      }
+      break;
+    case LBRACE:
+      depth++;
+      break;
+    case RBRACE:
+      if (depth > 0)
+        depth--;
+      if (depth == 0)
+      {
+        ctx->token = getToken(ctx);
+        return;
+      }
+      break;
+    default:
+      break;
+    }
+    ctx->token = getToken(ctx);
+  }
+}
+
+/* skip to the next statement: past a ; or a { ... } block, or up to
+ * the } that closes the compound statement
+ */
+static void syncStmt(CompilerContext *ctx)
+{
+  int depth = 0;
+  for (;;)
+  {
+    switch (ctx->token)
+    {
+    case ENDFILE:
+      return;
+    case SEMI:
+      if (depth == 0)
+      {
+        ctx->token = getToken(ctx);
+        return;
+      }
+      break;
+    case LBRACE:
+      depth++;
+      break;
+    case RBRACE:
+      if (depth == 0)
+        return;
+      if (--depth == 0)
+      {
+        ctx->token = getToken(ctx);
+        return;
+      }
+      break;
+    default:
+      break;
+    }
+    ctx->token = getToken(ctx);
+  }
 }
 
 /**
  * [HW2] Jiho Rhee
  */
-/* consume COMMENT token & check next token */
-static int check(TokenType expected)
+/* check next token; the scanner drops COMMENT
+ * tokens while parsing (ctx->skipComments)
+ */
+static int check(CompilerContext *ctx, TokenType expected)
 {
-  while (token == COMMENT)
-    token = getToken();
-  return token == expected;
+  return ctx->token == expected;
 }
 
 /* is the TreeNode a function declaration? */
@@ -148,22 +262,38 @@ static int is_func_call(TreeNode *t)
 }
 
 /* declaration-list → declaration-list declaration | declaration */
-static TreeNode *declare_list(void)
+static TreeNode *declare_list(CompilerContext *ctx)
 {
-  TreeNode *t = declare();
-  TreeNode *p = t;
+  /* kept across longjmp() */
+  TreeNode *volatile t = NULL;
+  TreeNode *volatile p = NULL;
+  jmp_buf here;
+  int depth = spanDepth(ctx);
 
-  /* FuncDecl is not followed by SEMI(;). */
-  if (!is_func_decl(t))
-    match(SEMI);
+  if (setjmp(here))
+  {
+    /* close the spans that fail() jumped out of */
+    spanUnwind(ctx, depth);
+    if (!stopped(ctx))
+      syncDeclare(ctx);
+    if (stopped(ctx))
+    {
+      ctx->recover = NULL;
+      return t;
+    }
+  }
+  ctx->recover = &here;
 
-  while (check(ENDFILE) == FALSE)
+  do
   {
     TreeNode *q;
-    q = declare();
+    /* every top-level declaration is a span in --trace-out */
+    spanBegin(ctx, "declaration");
+    q = declare(ctx);
     /* FuncDecl is not followed by SEMI(;). */
     if (!is_func_decl(q))
-      match(SEMI);
+      match(ctx, SEMI);
+    spanEnd(ctx, q != NULL ? q->attr.name : NULL);
 
     if (q != NULL)
     {
@@ -175,68 +305,69 @@ static TreeNode *declare_list(void)
         p = q;
       }
     }
-  }
+  } while (check(ctx, ENDFILE) == FALSE);
+  ctx->recover = NULL;
   return t;
 }
 
 /* declaration → var-declaration | fun-declaration */
-static TreeNode *declare(void)
+static TreeNode *declare(CompilerContext *ctx)
 {
-  if (check(ENDFILE))
+  if (check(ctx, ENDFILE))
     return NULL;
 
   TreeNode *t = NULL;
-  ExpType type = type_spec();
-  char *name = copyString(tokenString);
+  ExpType type = type_spec(ctx);
+  const char *name = internLexeme(ctx);
   int arr_size;
 
-  match(ID);
+  match(ctx, ID);
 
-  switch (token)
+  switch (ctx->token)
   {
   case SEMI: /* Variable declaration. ex) int a; */
-    t = newStmtNode(VarDeclK);
+    t = newStmtNode(ctx, VarDeclK);
     if (t != NULL)
     {
       t->attr.name = name;
       t->type = type;
-      t->child[0] = newTypeNode(t->type);
+      t->child[0] = newTypeNode(ctx, t->type);
     }
     break;
   case LBRACKET: /* Array declaration. ex) int arr[10]; */
-    t = newStmtNode(ArrayDeclK);
+    t = newStmtNode(ctx, ArrayDeclK);
     if (t != NULL)
     {
       t->attr.name = name;
       t->type = type;
-      t->child[0] = newTypeNode(IntegerArray);
+      t->child[0] = newTypeNode(ctx, IntegerArray);
     }
-    match(LBRACKET);
+    match(ctx, LBRACKET);
     if (t != NULL)
     {
-      t->arr_size = atoi(tokenString);
-      t->child[1] = newArrSizeNode(t->arr_size);
+      t->arr_size = lexemeValue(ctx);
+      t->child[1] = newArrSizeNode(ctx, t->arr_size);
     }
-    match(NUM);
-    match(RBRACKET);
+    match(ctx, NUM);
+    match(ctx, RBRACKET);
     break;
   case LPAREN: /* Function declaration. ex) int sort(int arr[], int size) {...} */
-    t = newStmtNode(FuncDeclK);
+    t = newStmtNode(ctx, FuncDeclK);
     if (t != NULL)
     {
       t->attr.name = name;
       t->type = type;
-      t->child[0] = newTypeNode(t->type);
+      t->child[0] = newTypeNode(ctx, t->type);
     }
-    match(LPAREN);
+    match(ctx, LPAREN);
     if (t != NULL)
-      t->child[1] = params();
-    match(RPAREN);
+      t->child[1] = params(ctx);
+    match(ctx, RPAREN);
     if (t != NULL)
-      t->child[2] = compound_stmt();
+      t->child[2] = compound_stmt(ctx);
     break;
   default:
-    fail(SEMI, "declare() failed. ( SEMI | LBRACKET | LPAREN )");
+    fail(ctx, SEMI, "declare() failed. ( SEMI | LBRACKET | LPAREN )");
     break;
   }
 
@@ -244,60 +375,60 @@ static TreeNode *declare(void)
 }
 
 /* var-declaration → type-specifier ID; | type-specifier ID [NUM]; */
-static TreeNode *var_declare(void)
+static TreeNode *var_declare(CompilerContext *ctx)
 {
   TreeNode *t = NULL;
-  ExpType type = type_spec();
-  char *name = copyString(tokenString);
-  match(ID);
+  ExpType type = type_spec(ctx);
+  const char *name = internLexeme(ctx);
+  match(ctx, ID);
 
-  switch (token)
+  switch (ctx->token)
   {
   case SEMI: /* var */
-    t = newStmtNode(VarDeclK);
+    t = newStmtNode(ctx, VarDeclK);
     if (t != NULL)
     {
       t->attr.name = name;
-      t->child[0] = newTypeNode(type);
+      t->child[0] = newTypeNode(ctx, type);
     }
     break;
   case LBRACKET: /* array */
-    t = newStmtNode(ArrayDeclK);
-    match(LBRACKET);
+    t = newStmtNode(ctx, ArrayDeclK);
+    match(ctx, LBRACKET);
     if (t != NULL)
     {
       t->attr.name = name;
-      t->arr_size = atoi(tokenString);
-      t->child[0] = newTypeNode(IntegerArray);
-      t->child[1] = newArrSizeNode(t->arr_size);
+      t->arr_size = lexemeValue(ctx);
+      t->child[0] = newTypeNode(ctx, IntegerArray);
+      t->child[1] = newArrSizeNode(ctx, t->arr_size);
     }
-    match(NUM);
-    match(RBRACKET);
+    match(ctx, NUM);
+    match(ctx, RBRACKET);
     break;
   default:
-    fail(SEMI, "var_declare() failed. ( SEMI | LBRACKET )");
+    fail(ctx, SEMI, "var_declare() failed. ( SEMI | LBRACKET )");
     break;
   }
 
-  match(SEMI);
+  match(ctx, SEMI);
 
   return t;
 }
 
 /* type-specifier → int | void */
-static ExpType type_spec(void)
+static ExpType type_spec(CompilerContext *ctx)
 {
-  check(token);
-  switch (token)
+  check(ctx, ctx->token);
+  switch (ctx->token)
   {
   case INT:
-    token = getToken();
+    ctx->token = getToken(ctx);
     return Integer;
   case VOID:
-    token = getToken();
+    ctx->token = getToken(ctx);
     return Void;
   default:
-    fail(INT, "type_spec() failed. ( INT | VOID )");
+    fail(ctx, INT, "type_spec() failed. ( INT | VOID )");
   }
 
   /* not reached */
@@ -305,39 +436,39 @@ static ExpType type_spec(void)
 }
 
 /* fun-declaration → type-specifier ID ( params ) compound-stmt */
-static TreeNode *fun_declare(void)
+static TreeNode *fun_declare(CompilerContext *ctx)
 {
-  TreeNode *t = newStmtNode(FuncDeclK);
-  ExpType type = type_spec();
-  char *name = copyString(tokenString);
-  match(ID);
-  match(LPAREN);
-  t->child[0] = params();
-  match(RPAREN);
-  t->child[1] = compound_stmt();
+  TreeNode *t = newStmtNode(ctx, FuncDeclK);
+  ExpType type = type_spec(ctx);
+  const char *name = internLexeme(ctx);
+  match(ctx, ID);
+  match(ctx, LPAREN);
+  t->child[0] = params(ctx);
+  match(ctx, RPAREN);
+  t->child[1] = compound_stmt(ctx);
 
   return t;
 }
 
 /* params → param-list | void */
-static TreeNode *params(void)
+static TreeNode *params(CompilerContext *ctx)
 {
-  TreeNode *t = newExpNode(ParamListK);
+  TreeNode *t = newExpNode(ctx, ParamListK);
 
-  check(token);
-  switch (token)
+  check(ctx, ctx->token);
+  switch (ctx->token)
   {
   case INT:
     if (t != NULL)
-      t->child[0] = param_list();
+      t->child[0] = param_list(ctx);
     break;
   case VOID:
-    match(VOID);
+    match(ctx, VOID);
     if (t != NULL)
-      t->child[0] = newTypeNode(Void);
+      t->child[0] = newTypeNode(ctx, Void);
     break;
   default:
-    fail(INT, "params() failed. ( INT | VOID )");
+    fail(ctx, INT, "params() failed. ( INT | VOID )");
     break;
   }
 
@@ -345,15 +476,15 @@ static TreeNode *params(void)
 }
 
 /* param-list → param-list , param | param */
-static TreeNode *param_list(void)
+static TreeNode *param_list(CompilerContext *ctx)
 {
-  TreeNode *t = param();
+  TreeNode *t = param(ctx);
   TreeNode *p = t;
   TreeNode *q;
-  while (check(COMMA))
+  while (check(ctx, COMMA))
   {
-    match(COMMA);
-    q = param();
+    match(ctx, COMMA);
+    q = param(ctx);
     if (q != NULL)
     {
       if (t == NULL)
@@ -372,35 +503,35 @@ static TreeNode *param_list(void)
  * param → type-specifier ID | type-specifier ID [ ]
  * Here, type-specifier must be INT.
  */
-static TreeNode *param(void)
+static TreeNode *param(CompilerContext *ctx)
 {
-  TreeNode *t = newExpNode(ParamK);
-  match(INT);
-  char *name = copyString(tokenString);
+  TreeNode *t = newExpNode(ctx, ParamK);
+  match(ctx, INT);
+  const char *name = internLexeme(ctx);
   set_name(t, name);
-  match(ID);
+  match(ctx, ID);
 
-  switch (token)
+  switch (ctx->token)
   {
   case COMMA:
   case RPAREN:
     if (t != NULL)
     {
       t->type = Integer;
-      t->child[0] = newTypeNode(Integer);
+      t->child[0] = newTypeNode(ctx, Integer);
     }
     break;
   case LBRACKET:
-    match(LBRACKET);
-    match(RBRACKET);
+    match(ctx, LBRACKET);
+    match(ctx, RBRACKET);
     if (t != NULL)
     {
       t->type = IntegerArray;
-      t->child[0] = newTypeNode(IntegerArray);
+      t->child[0] = newTypeNode(ctx, IntegerArray);
     }
     break;
   default:
-    fail(COMMA, "param() failed. ( COMMA | RPAREN | LBRACKET )");
+    fail(ctx, COMMA, "param() failed. ( COMMA | RPAREN | LBRACKET )");
     break;
   }
 
@@ -408,30 +539,85 @@ static TreeNode *param(void)
 }
 
 /* compound-stmt → { local-declarations statement-list } */
-static TreeNode *compound_stmt(void)
+static TreeNode *compound_stmt(CompilerContext *ctx)
 {
-  TreeNode *t = newStmtNode(CompoundK);
-  match(LBRACE);
-  t->child[0] = local_declare();
-  t->child[1] = stmt_list();
-  match(RBRACE);
+  TreeNode *t = newStmtNode(ctx, CompoundK);
+  match(ctx, LBRACE);
+  if (ctx->maxErrors != 1)
+    return compound_body(ctx, t);
+  t->child[0] = local_declare(ctx);
+  t->child[1] = stmt_list(ctx);
+  match(ctx, RBRACE);
+  return t;
+}
+
+/* local-declarations statement-list } of compound statement T, with
+ * a recovery point: a declaration or statement in error is skipped
+ */
+static TreeNode *compound_body(CompilerContext *ctx, TreeNode *t)
+{
+  /* kept across longjmp() */
+  TreeNode *volatile decls = NULL, *volatile lastDecl = NULL;
+  TreeNode *volatile stmts = NULL, *volatile lastStmt = NULL;
+  jmp_buf here;
+  jmp_buf *outer = ctx->recover;
+
+  if (setjmp(here))
+  {
+    if (!stopped(ctx))
+      syncStmt(ctx);
+    if (stopped(ctx))
+      giveUp(ctx, outer);
+  }
+  ctx->recover = &here;
+
+  while (check(ctx, INT) || check(ctx, VOID))
+  {
+    TreeNode *q = var_declare(ctx);
+    if (q == NULL)
+      continue;
+    if (decls == NULL)
+      decls = q;
+    else
+      lastDecl->sibling = q;
+    lastDecl = q;
+  }
+  while (check(ctx, RBRACE) == FALSE)
+  {
+    TreeNode *q = stmt(ctx);
+    if (q == NULL)
+      continue;
+    if (stmts == NULL)
+      stmts = q;
+    else
+      lastStmt->sibling = q;
+    lastStmt = q;
+  }
+  ctx->recover = outer;
+
+  if (t != NULL)
+  {
+    t->child[0] = decls;
+    t->child[1] = stmts;
+  }
+  match(ctx, RBRACE);
   return t;
 }
 
 /* local-declarations → local-declarations var-declaration | empty */
-static TreeNode *local_declare(void)
+static TreeNode *local_declare(CompilerContext *ctx)
 {
-  if (check(INT) == FALSE && check(VOID) == FALSE) /* empty */
+  if (check(ctx, INT) == FALSE && check(ctx, VOID) == FALSE) /* empty */
     return NULL;
 
   /* local-declarations var-declaration */
-  TreeNode *t = var_declare();
+  TreeNode *t = var_declare(ctx);
   TreeNode *p = t;
 
-  while (check(INT) || check(VOID))
+  while (check(ctx, INT) || check(ctx, VOID))
   {
     TreeNode *q;
-    q = var_declare();
+    q = var_declare(ctx);
     if (q != NULL)
     {
       if (t == NULL)
@@ -447,18 +633,18 @@ static TreeNode *local_declare(void)
 }
 
 /* statement-list → statement-list statement | empty */
-static TreeNode *stmt_list(void)
+static TreeNode *stmt_list(CompilerContext *ctx)
 {
-  if (check(RBRACE)) /* empty */
+  if (check(ctx, RBRACE)) /* empty */
     return NULL;
 
-  TreeNode *t = stmt();
+  TreeNode *t = stmt(ctx);
   TreeNode *p = t;
 
-  while (check(RBRACE) == FALSE)
+  while (check(ctx, RBRACE) == FALSE)
   {
     TreeNode *q;
-    q = stmt();
+    q = stmt(ctx);
     if (q != NULL)
     {
       if (t == NULL)
@@ -474,44 +660,44 @@ static TreeNode *stmt_list(void)
 }
 
 /* statement → expression-stmt | compound-stmt | selection-stmt | iteration-stmt | return-stmt */
-static TreeNode *stmt(void)
+static TreeNode *stmt(CompilerContext *ctx)
 {
   TreeNode *t = NULL;
-  check(token);
-  switch (token)
+  check(ctx, ctx->token);
+  switch (ctx->token)
   {
   case LBRACE: /* compound-stmt */
-    t = compound_stmt();
+    t = compound_stmt(ctx);
     break;
   case IF: /* selection-stmt */
-    t = select_stmt();
+    t = select_stmt(ctx);
     break;
   case WHILE: /* iteration-stmt */
-    t = iter_stmt();
+    t = iter_stmt(ctx);
     break;
   case RETURN: /* return-stmt */
-    t = return_stmt();
+    t = return_stmt(ctx);
     break;
   default: /* expression-stmt */
-    t = expr_stmt();
+    t = expr_stmt(ctx);
     break;
   }
   return t;
 }
 
 /* expression-stmt → expression ; | ; */
-static TreeNode *expr_stmt(void)
+static TreeNode *expr_stmt(CompilerContext *ctx)
 {
   TreeNode *t = NULL;
-  check(token);
-  switch (token)
+  check(ctx, ctx->token);
+  switch (ctx->token)
   {
   case SEMI: /* ; */
-    match(SEMI);
+    match(ctx, SEMI);
     break;
   default: /* expression ; */
-    t = expr();
-    match(SEMI);
+    t = expr(ctx);
+    match(ctx, SEMI);
     break;
   }
 
@@ -519,14 +705,14 @@ static TreeNode *expr_stmt(void)
 }
 
 /* selction-stmt → if ( expression ) statement | if ( expression ) statement else statement */
-static TreeNode *select_stmt(void)
+static TreeNode *select_stmt(CompilerContext *ctx)
 {
-  TreeNode *t = newStmtNode(IfK);
-  match(IF);
-  match(LPAREN);
-  TreeNode *e = expr();
-  match(RPAREN);
-  TreeNode *s = stmt();
+  TreeNode *t = newStmtNode(ctx, IfK);
+  match(ctx, IF);
+  match(ctx, LPAREN);
+  TreeNode *e = expr(ctx);
+  match(ctx, RPAREN);
+  TreeNode *s = stmt(ctx);
 
   if (t != NULL)
   {
@@ -534,11 +720,11 @@ static TreeNode *select_stmt(void)
     t->child[1] = s;
   }
 
-  if (check(ELSE))
+  if (check(ctx, ELSE))
   {
-    TreeNode *q = newStmtNode(ElseK);
-    match(ELSE);
-    s = stmt();
+    TreeNode *q = newStmtNode(ctx, ElseK);
+    match(ctx, ELSE);
+    s = stmt(ctx);
     if (t != NULL)
       t->sibling = q;
     if (q != NULL)
@@ -549,77 +735,85 @@ static TreeNode *select_stmt(void)
 }
 
 /* iteration-stmt → while ( expression ) statement */
-static TreeNode *iter_stmt(void)
+static TreeNode *iter_stmt(CompilerContext *ctx)
 {
-  TreeNode *t = newStmtNode(WhileK);
-  match(WHILE);
-  match(LPAREN);
+  TreeNode *t = newStmtNode(ctx, WhileK);
+  match(ctx, WHILE);
+  match(ctx, LPAREN);
   if (t != NULL)
-    t->child[0] = expr();
-  match(RPAREN);
+    t->child[0] = expr(ctx);
+  match(ctx, RPAREN);
   if (t != NULL)
-    t->child[1] = stmt();
+    t->child[1] = stmt(ctx);
 
   return t;
 }
 
 /* return-stmt → return ; | return expression ; */
-static TreeNode *return_stmt(void)
+static TreeNode *return_stmt(CompilerContext *ctx)
 {
-  TreeNode *t = newStmtNode(ReturnK);
-  match(RETURN);
-  switch (token)
+  TreeNode *t = newStmtNode(ctx, ReturnK);
+  match(ctx, RETURN);
+  switch (ctx->token)
   {
   case SEMI: /* return void */
     if (t != NULL)
-      t->child[0] = newTypeNode(Void);
+      t->child[0] = newTypeNode(ctx, Void);
     break;
   default: /* return expression */
     if (t != NULL)
-      t->child[0] = expr();
+      t->child[0] = expr(ctx);
   }
 
-  match(SEMI);
+  match(ctx, SEMI);
   return t;
 }
 
 /**
  * expression → var = expression | simple-expression
  */
-static TreeNode *expr(void)
+static TreeNode *expr(CompilerContext *ctx)
 {
   TreeNode *t = NULL;
 
-  if (check(ID))
+  if (check(ctx, ID))
   {
     /* In this case, "expression" starts with "var". */
 
-    TreeNode *v = call();
+    TreeNode *v = call(ctx);
 
-    if (token == ASSIGN) /* var = expression */
-    {
-      if (is_func_call(v))
-      {
-        char msg[128];
-        sprintf(msg, "expr() failed. attempted to assign value to: %s()", v->attr.name);
-        fail(SEMI, msg);
-        //     syntaxError("assign statement cannot start with func call.\n");
-        // fprintf(listing, "\t\tattempted to assign value to: %s()\n", v->attr.name);
-      }
-      t = newStmtNode(AssignK);
-      match(ASSIGN);
-      if (t != NULL)
-        t->child[0] = v;
-
-      TreeNode *q = expr();
-      if (t != NULL)
-        t->child[1] = q;
-    }
+    if (ctx->token == ASSIGN) /* var = expression */
+      t = assign_expr(ctx, v);
     else /* "simple-expression" which starts with "ID". */
-      t = simple_expr(v);
+      t = simple_expr(ctx, v);
   }
   else /* "simple-expression" which does not start with "ID". */
-    t = simple_expr(NULL);
+    t = simple_expr(ctx, NULL);
+
+  return t;
+}
+
+/* expression → var = expression, V being the var */
+static TreeNode *assign_expr(CompilerContext *ctx, TreeNode *v)
+{
+  TreeNode *t;
+
+  if (is_func_call(v))
+  {
+    char msg[128];
+    sprintf(msg, "expr() failed. attempted to assign value to: %s()", v->attr.name);
+    fail(ctx, SEMI, msg);
+    //     syntaxError("assign statement cannot start with func call.\n");
+    // fprintf(listing, "\t\tattempted to assign value to: %s()\n", v->attr.name);
+  }
+  t = newStmtNode(ctx, AssignK);
+  match(ctx, ASSIGN);
+  if (t != NULL)
+    t->child[0] = v;
+
+  TreeNode *q = expr(ctx);
+  if (t != NULL)
+    t->child[1] = q;
 
   return t;
 }
@@ -650,135 +844,171 @@ static TreeNode *expr(void)
 
 /**
  * simple-expression → additive-expression relop additive-expression | additive-expression
+ * additive-expression → additive-expression addop term | term
+ * term → term mulop factor | factor
+ *
+ * The three rules are parsed by operator precedence in one loop.
+ * Each rule is a level; an operand closes the levels above the
+ * precedence of the operator that follows it. A level keeps its
+ * node only once it has an operator, so a lone operand gets no
+ * wrapper:
+ *   SimpleExpK: left operand child[0], relop child[1], right child[2]
+ *   AddExpK, TermK: child[0] → operand, op, operand, ... as siblings
+ * Parentheses open a new frame instead of recursing, up to
+ * PARENDEPTH; factor() recurses for deeper ones.
  */
-static TreeNode *simple_expr(TreeNode *start)
+
+/* precedence of the binary operators; PrecNone ends an expression */
+enum
 {
-  check(token);
+  PrecNone,
+  PrecRel, /* simple-expression: at most one relop */
+  PrecAdd, /* additive-expression */
+  PrecMul, /* term */
+  NPREC
+};
+
+static const unsigned char precedence[RBRACKET + 1] = {
+    [LT] = PrecRel, [LTEQ] = PrecRel, [GT] = PrecRel,
+    [GTEQ] = PrecRel, [EQ] = PrecRel, [NOTEQ] = PrecRel,
+    [PLUS] = PrecAdd, [MINUS] = PrecAdd,
+    [TIMES] = PrecMul, [OVER] = PrecMul};
+
+/* PARENDEPTH is the number of open parentheses one
+ * simple_expr() call handles without recursion
+ */
+#define PARENDEPTH 32
 
-  TreeNode *t = newSimpleExpNode();
-  int trim_flag = TRUE;
-  if (t != NULL)
-    t->child[0] = add_expr(start);
+/* the open rules of one parenthesized expression */
+typedef struct
+{
+  TreeNode *node[NPREC]; /* of each level, NULL until it has an operator */
+  TreeNode *tail[NPREC]; /* last of its sibling list */
+  int done;              /* an assignment: no operator may follow */
+} OpFrame;
 
-  if (is_relop(token))
+/* append operand T and the operator node OP to level PREC of F */
+static void openLevel(CompilerContext *ctx, OpFrame *f, int prec, TreeNode *t, TreeNode *op)
+{
+  if (f->node[prec] == NULL)
   {
-    trim_flag = FALSE;
-    TreeNode *relop = newExpNode(OpK);
-    if (relop != NULL)
-      relop->attr.op = token;
-    match(token);
-
+    f->node[prec] = prec == PrecRel ? newSimpleExpNode(ctx)
+                  : prec == PrecAdd ? newAddExpNode(ctx)
+                                    : newExpNode(ctx, TermK);
+    if (f->node[prec] == NULL)
+      return;
     if (t != NULL)
-    {
-      t->child[1] = relop;
-      t->child[2] = add_expr(NULL);
-    }
+      f->node[prec]->offset = t->offset; /* of its first token */
+    f->node[prec]->child[0] = t;
+    f->node[prec]->child[1] = prec == PrecRel ? op : NULL;
+    f->tail[prec] = t;
+  }
+  else if (f->tail[prec] != NULL)
+    f->tail[prec]->sibling = t;
+  if (prec != PrecRel && t != NULL)
+  {
+    t->sibling = op;
+    f->tail[prec] = op;
   }
-
-  if (trim_flag)
-    t = t->child[0];
-
-  return t;
 }
 
-/**
- * additive-expression → additive-expression addop term | term
- * t = newExpNode(AddExpK)로 새로운 additive-expression node를 생성하고,
- * t->child[0]에 term node를 추가한다.
- * 이후의 모든 addop, term node는 t->child[0]의 sibling으로 연결한다.
+/* end level PREC of F with operand T; returns the level's node,
+ * or T if the level had no operator
  */
-static TreeNode *add_expr(TreeNode *start)
+static TreeNode *closeLevel(OpFrame *f, int prec, TreeNode *t)
 {
-  check(token);
+  TreeNode *node = f->node[prec];
+  if (node == NULL)
+    return t;
+  if (prec == PrecRel)
+    node->child[2] = t;
+  else if (f->tail[prec] != NULL)
+    f->tail[prec]->sibling = t;
+  f->node[prec] = NULL;
+  f->tail[prec] = NULL;
+  return node;
+}
 
-  TreeNode *t = newAddExpNode();
-  TreeNode *term_tail = term(start);
-  int trim_flag = TRUE;
-  if (t != NULL)
-    t->child[0] = term_tail;
+/* START is the var or call already parsed as the first operand, or NULL */
+static TreeNode *simple_expr(CompilerContext *ctx, TreeNode *start)
+{
+  OpFrame frame[PARENDEPTH];
+  int depth = 0; /* open parentheses */
+  TreeNode *t = start;
 
-  while (is_addop(token)) /* additive-expression addop term */
+  memset(&frame[0], 0, sizeof(OpFrame));
+  for (;;)
   {
-    trim_flag = FALSE;
-    TreeNode *op = addop();
-    TreeNode *p = term(NULL);
-    if (term_tail != NULL && op != NULL)
+    if (t == NULL)
     {
-      op->sibling = p;
-      term_tail->sibling = op;
-      term_tail = p; /* term_tail can be null. */
+      /* an operand: ( expression ) opens a frame */
+      while (ctx->token == LPAREN && depth + 1 < PARENDEPTH)
+      {
+        match(ctx, LPAREN);
+        memset(&frame[++depth], 0, sizeof(OpFrame));
+        if (ctx->token == ID)
+        {
+          t = call(ctx);
+          if (ctx->token == ASSIGN)
+          {
+            t = assign_expr(ctx, t);
+            frame[depth].done = TRUE;
+          }
+          break;
+        }
+      }
+      if (t == NULL)
+        t = factor(ctx);
     }
-  }
-
-  if (trim_flag)
-    t = t->child[0];
 
-  return t;
-}
-
-/**
- * term → term mulop factor ( 수정: term → term mulop factor | factor )
- * t = newExpNode(TermK)로 새로운 term node를 생성하고,
- * t->child[0]에 factor node를 추가한다.
- * 이후의 모든 mulop, factor는 t->child[0]의 sibling으로 연결한다.
- */
-static TreeNode *term(TreeNode *start)
-{
-  check(token);
-
-  TreeNode *t = newExpNode(TermK);
-  TreeNode *factor_tail = factor(start);
-  int trim_flag = TRUE;
-  if (t != NULL)
-    t->child[0] = factor_tail;
-
-  while (is_mulop(token))
-  {
-    trim_flag = FALSE;
-    TreeNode *op = mulop();
-    TreeNode *p = factor(NULL);
-    if (factor_tail != NULL && op != NULL)
+    /* operators: close the levels that bind tighter */
+    for (;;)
     {
-      factor_tail->sibling = op;
-      op->sibling = p;
-      factor_tail = p; /* factor_tail can be NULL. */
+      OpFrame *f = &frame[depth];
+      int prec = f->done ? PrecNone : precedence[ctx->token];
+      int p;
+      if (prec == PrecRel && f->node[PrecRel] != NULL)
+        prec = PrecNone; /* a second relop ends the simple-expression */
+      for (p = NPREC - 1; p > prec; p--)
+        t = closeLevel(f, p, t);
+      if (prec != PrecNone)
+      {
+        TreeNode *op = newOpNode(ctx, ctx->token);
+        match(ctx, ctx->token);
+        openLevel(ctx, f, prec, t, op);
+        t = NULL;
+        break;
+      }
+      if (depth == 0)
+        return t;
+      match(ctx, RPAREN);
+      depth--;
     }
   }
-
-  if (trim_flag)
-    t = t->child[0];
-
-  return t;
 }
 
 /**
  * factor → ( expression ) | var | call | NUM
- * if START != NULL, then tokens for "var | call" are already consumed(parsed).
  */
-static TreeNode *factor(TreeNode *start)
+static TreeNode *factor(CompilerContext *ctx)
 {
-  check(token);
-
-  if (start != NULL) /* var | call */
-    return start;
-
   TreeNode *t = NULL;
-  switch (token)
+  switch (ctx->token)
   {
   case LPAREN: /* ( expression ) */
-    match(LPAREN);
-    t = expr();
-    match(RPAREN);
+    match(ctx, LPAREN);
+    t = expr(ctx);
+    match(ctx, RPAREN);
     break;
   case NUM: /* NUM */
-    t = newConstExpNode(atoi(tokenString));
-    match(NUM);
+    t = newConstExpNode(ctx, lexemeValue(ctx));
+    match(ctx, NUM);
     break;
   case ID: /* var | call */
-    t = call();
+    t = call(ctx);
     break;
   default:
-    fail(LPAREN, "factor() failed. ( LPAREN | NUM )");
+    fail(ctx, LPAREN, "factor() failed. ( LPAREN | NUM )");
     // syntaxError("unexpected token ( factor() ) -> ");
     // printToken(token, tokenString);
     break;
@@ -787,60 +1017,6 @@ static TreeNode *factor(TreeNode *start)
   return t;
 }
 
-/* relop → <= | < | >= | > | == | != */
-static TreeNode *relop(void)
-{
-  check(token);
-
-  TreeNode *t = newExpNode(OpK);
-  if (!is_relop(token))
-    fail(LT, "relop() failed. ( LT | LTEQ | GT | GTEQ | EQ | NOTEQ )");
-  else
-  {
-    if (t != NULL)
-      t->attr.op = token;
-  }
-
-  match(token);
-  return t;
-}
-
-/* addop → + | - */
-static TreeNode *addop(void)
-{
-  check(token);
-
-  TreeNode *t = newExpNode(OpK);
-  if (!is_addop(token))
-    fail(PLUS, "addop() failed. ( PLUS | MINUS )");
-  else
-  {
-    if (t != NULL)
-      t->attr.op = token;
-  }
-
-  match(token);
-  return t;
-}
-
-/* mulop → * | / */
-static TreeNode *mulop(void)
-{
-  check(token);
-
-  TreeNode *t = newExpNode(OpK);
-  if (!is_mulop(token))
-    fail(TIMES, "mulop() failed. ( TIMES | OVER )");
-  else
-  {
-    if (t != NULL)
-      t->attr.op = token;
-  }
-
-  match(token);
-  return t;
-}
-
 /**
  * call → ID ( args )
  * var → ID | ID [ expression ]
@@ -848,38 +1024,38 @@ static TreeNode *mulop(void)
  * However, call() must distinguish [var | array | func] call by checking token.
  * VarCallK | ArrayCallK | FuncCallK
  */
-static TreeNode *call(void)
+static TreeNode *call(CompilerContext *ctx)
 {
   TreeNode *t = NULL;
-  char *name = copyString(tokenString);
-  match(ID);
+  const char *name = internLexeme(ctx);
+  match(ctx, ID);
 
-  switch (token)
+  switch (ctx->token)
   {
   case LPAREN: /* Function */
-    t = newExpNode(FuncCallK);
-    match(LPAREN);
+    t = newExpNode(ctx, FuncCallK);
+    match(ctx, LPAREN);
     if (t != NULL)
     {
       t->attr.name = name;
-      t->child[0] = args();
+      t->child[0] = args(ctx);
     }
-    match(RPAREN);
+    match(ctx, RPAREN);
     break;
   case LBRACKET: /* Array */
-    t = newExpNode(ArrayCallK);
-    match(LBRACKET);
+    t = newExpNode(ctx, ArrayCallK);
+    match(ctx, LBRACKET);
     if (t != NULL)
     {
       t->attr.name = name;
-      t->child[0] = newExpNode(ArrayIndexK);
+      t->child[0] = newExpNode(ctx, ArrayIndexK);
       if (t->child[0] != NULL)
-        t->child[0]->child[0] = expr();
+        t->child[0]->child[0] = expr(ctx);
     }
-    match(RBRACKET);
+    match(ctx, RBRACKET);
     break;
   default: /* Variable */
-    t = newExpNode(VarCallK);
+    t = newExpNode(ctx, VarCallK);
     if (t != NULL)
       t->attr.name = name;
     break;
@@ -889,29 +1065,29 @@ static TreeNode *call(void)
 }
 
 /* args → arg-list | empty */
-static TreeNode *args(void)
+static TreeNode *args(CompilerContext *ctx)
 {
-  if (check(RPAREN)) /* empty */
+  if (check(ctx, RPAREN)) /* empty */
     return NULL;
 
-  TreeNode *t = arg_list();
+  TreeNode *t = arg_list(ctx);
   return t;
 }
 
 /* arg-list → arg-list , expression | expression */
-static TreeNode *arg_list(void)
+static TreeNode *arg_list(CompilerContext *ctx)
 {
-  TreeNode *t = newExpNode(ArgK);
-  TreeNode *exp = expr();
+  TreeNode *t = newExpNode(ctx, ArgK);
+  TreeNode *exp = expr(ctx);
   if (t != NULL)
     t->child[0] = exp;
 
-  while (check(COMMA))
+  while (check(ctx, COMMA))
   {
-    match(COMMA);
+    match(ctx, COMMA);
     if (exp != NULL)
     {
-      exp->sibling = expr();
+      exp->sibling = expr(ctx);
       exp = exp->sibling;
     }
   }
@@ -919,6 +1095,298 @@ static TreeNode *arg_list(void)
   return t;
 }
 
+/****************************************/
+/* Syntax-only recognizer (--syntax-only) */
+/****************************************/
+
+/* The rec_* procedures follow the grammar functions
+ * above token for token, but allocate no nodes and
+ * copy no names.
+ */
+static void rec_expr(CompilerContext *ctx);
+static void rec_stmt(CompilerContext *ctx);
+static void rec_compound_stmt(CompilerContext *ctx);
+
+/* type-specifier → int | void */
+static void rec_type_spec(CompilerContext *ctx)
+{
+  check(ctx, ctx->token);
+  if (ctx->token == INT || ctx->token == VOID)
+    ctx->token = getToken(ctx);
+  else
+    fail(ctx, INT, "type_spec() failed. ( INT | VOID )");
+}
+
+/* param → type-specifier ID | type-specifier ID [ ] */
+static void rec_param(CompilerContext *ctx)
+{
+  match(ctx, INT);
+  match(ctx, ID);
+  switch (ctx->token)
+  {
+  case COMMA:
+  case RPAREN:
+    break;
+  case LBRACKET:
+    match(ctx, LBRACKET);
+    match(ctx, RBRACKET);
+    break;
+  default:
+    fail(ctx, COMMA, "param() failed. ( COMMA | RPAREN | LBRACKET )");
+    break;
+  }
+}
+
+/* params → param-list | void */
+static void rec_params(CompilerContext *ctx)
+{
+  check(ctx, ctx->token);
+  switch (ctx->token)
+  {
+  case INT:
+    rec_param(ctx);
+    while (check(ctx, COMMA))
+    {
+      match(ctx, COMMA);
+      rec_param(ctx);
+    }
+    break;
+  case VOID:
+    match(ctx, VOID);
+    break;
+  default:
+    fail(ctx, INT, "params() failed. ( INT | VOID )");
+    break;
+  }
+}
+
+/* declaration → var-declaration | fun-declaration
+ * returns TRUE for a function declaration
+ */
+static int rec_declare(CompilerContext *ctx)
+{
+  if (check(ctx, ENDFILE))
+    return FALSE;
+
+  rec_type_spec(ctx);
+  match(ctx, ID);
+  switch (ctx->token)
+  {
+  case SEMI:
+    break;
+  case LBRACKET:
+    match(ctx, LBRACKET);
+    match(ctx, NUM);
+    match(ctx, RBRACKET);
+    break;
+  case LPAREN:
+    match(ctx, LPAREN);
+    rec_params(ctx);
+    match(ctx, RPAREN);
+    rec_compound_stmt(ctx);
+    return TRUE;
+  default:
+    fail(ctx, SEMI, "declare() failed. ( SEMI | LBRACKET | LPAREN )");
+    break;
+  }
+  return FALSE;
+}
+
+/* var-declaration → type-specifier ID; | type-specifier ID [NUM]; */
+static void rec_var_declare(CompilerContext *ctx)
+{
+  rec_type_spec(ctx);
+  match(ctx, ID);
+  switch (ctx->token)
+  {
+  case SEMI:
+    break;
+  case LBRACKET:
+    match(ctx, LBRACKET);
+    match(ctx, NUM);
+    match(ctx, RBRACKET);
+    break;
+  default:
+    fail(ctx, SEMI, "var_declare() failed. ( SEMI | LBRACKET )");
+    break;
+  }
+  match(ctx, SEMI);
+}
+
+/* compound-stmt → { local-declarations statement-list } */
+static void rec_compound_stmt(CompilerContext *ctx)
+{
+  match(ctx, LBRACE);
+  while (check(ctx, INT) || check(ctx, VOID))
+    rec_var_declare(ctx);
+  while (check(ctx, RBRACE) == FALSE)
+    rec_stmt(ctx);
+  match(ctx, RBRACE);
+}
+
+/* statement → expression-stmt | compound-stmt | selection-stmt | iteration-stmt | return-stmt */
+static void rec_stmt(CompilerContext *ctx)
+{
+  check(ctx, ctx->token);
+  switch (ctx->token)
+  {
+  case LBRACE:
+    rec_compound_stmt(ctx);
+    break;
+  case IF:
+    match(ctx, IF);
+    match(ctx, LPAREN);
+    rec_expr(ctx);
+    match(ctx, RPAREN);
+    rec_stmt(ctx);
+    if (check(ctx, ELSE))
+    {
+      match(ctx, ELSE);
+      rec_stmt(ctx);
+    }
+    break;
+  case WHILE:
+    match(ctx, WHILE);
+    match(ctx, LPAREN);
+    rec_expr(ctx);
+    match(ctx, RPAREN);
+    rec_stmt(ctx);
+    break;
+  case RETURN:
+    match(ctx, RETURN);
+    if (ctx->token != SEMI)
+      rec_expr(ctx);
+    match(ctx, SEMI);
+    break;
+  case SEMI:
+    match(ctx, SEMI);
+    break;
+  default:
+    rec_expr(ctx);
+    match(ctx, SEMI);
+    break;
+  }
+}
+
+/* call → ID ( args ) | var; returns TRUE for a call */
+static int rec_call(CompilerContext *ctx)
+{
+  match(ctx, ID);
+  switch (ctx->token)
+  {
+  case LPAREN:
+    match(ctx, LPAREN);
+    if (check(ctx, RPAREN) == FALSE)
+    {
+      rec_expr(ctx);
+      while (check(ctx, COMMA))
+      {
+        match(ctx, COMMA);
+        rec_expr(ctx);
+      }
+    }
+    match(ctx, RPAREN);
+    return TRUE;
+  case LBRACKET:
+    match(ctx, LBRACKET);
+    rec_expr(ctx);
+    match(ctx, RBRACKET);
+    break;
+  default:
+    break;
+  }
+  return FALSE;
+}
+
+/* factor → ( expression ) | var | call | NUM */
+static void rec_factor(CompilerContext *ctx, int started)
+{
+  check(ctx, ctx->token);
+  if (started)
+    return;
+  switch (ctx->token)
+  {
+  case LPAREN:
+    match(ctx, LPAREN);
+    rec_expr(ctx);
+    match(ctx, RPAREN);
+    break;
+  case NUM:
+    match(ctx, NUM);
+    break;
+  case ID:
+    rec_call(ctx);
+    break;
+  default:
+    fail(ctx, LPAREN, "factor() failed. ( LPAREN | NUM )");
+    break;
+  }
+}
+
+/* simple-expression, additive-expression and term:
+ * factors joined by operators, as simple_expr() reads
+ * them, with at most one relop
+ * started is TRUE if its first var or call was already consumed
+ */
+static void rec_simple_expr(CompilerContext *ctx, int started)
+{
+  int relop = FALSE;
+  rec_factor(ctx, started);
+  for (;;)
+  {
+    int prec = precedence[ctx->token];
+    if (prec == PrecNone || (prec == PrecRel && relop))
+      break;
+    relop = relop || prec == PrecRel;
+    match(ctx, ctx->token);
+    rec_factor(ctx, FALSE);
+  }
+}
+
+/* expression → var = expression | simple-expression */
+static void rec_expr(CompilerContext *ctx)
+{
+  if (check(ctx, ID))
+  {
+    int isCall = rec_call(ctx);
+    if (ctx->token == ASSIGN)
+    {
+      if (isCall)
+        fail(ctx, SEMI, "expr() failed. attempted to assign value to a function call");
+      match(ctx, ASSIGN);
+      rec_expr(ctx);
+    }
+    else
+      rec_simple_expr(ctx, TRUE);
+  }
+  else
+    rec_simple_expr(ctx, FALSE);
+}
+
+/* declaration-list → declaration-list declaration | declaration */
+static void rec_declare_list(CompilerContext *ctx)
+{
+  do
+  {
+    /* FuncDecl is not followed by SEMI(;). */
+    if (!rec_declare(ctx))
+      match(ctx, SEMI);
+  } while (check(ctx, ENDFILE) == FALSE);
+}
+
+int recognize(CompilerContext *ctx)
+{
+  if (setjmp(ctx->failJump))
+    return currentLine(ctx);
+  ctx->recover = NULL; /* the first error ends it */
+  ctx->skipComments = TRUE;
+  ctx->token = getToken(ctx);
+  rec_declare_list(ctx);
+  if (ctx->token != ENDFILE)
+    fail(ctx, ENDFILE, "parse() failed. Code ends before file.");
+  return 0;
+}
+
 /* A BNF for TINY. */
 // static TreeNode * stmt_sequence(void);
 // static TreeNode * statement(void);
@@ -1093,14 +1561,25 @@ static TreeNode *arg_list(void)
 /* Function parse returns the newly
  * constructed syntax tree
  */
-TreeNode *parse(void)
+TreeNode *parse(CompilerContext *ctx)
 {
   TreeNode *t;
-  token = getToken();
+  int depth = spanDepth(ctx);
+  if (setjmp(ctx->failJump))
+  {
+    /* close the spans that fail() jumped out of */
+    spanUnwind(ctx, depth);
+    return NULL;
+  }
+  ctx->recover = NULL;
+  ctx->syntaxErrors = 0;
+  /* comments are dropped by the scanner */
+  ctx->skipComments = TRUE;
+  ctx->token = getToken(ctx);
   // t = stmt_sequence();
-  t = declare_list();
-  if (token != ENDFILE)
+  t = declare_list(ctx);
+  if (ctx->token != ENDFILE && !stopped(ctx))
     // syntaxError("parse(): Code ends before file\n");
-    fail(ENDFILE, "parse() failed. Code ends before file.");
+    fail(ctx, ENDFILE, "parse() failed. Code ends before file.");
   return t;
 }
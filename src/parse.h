@@ -9,8 +9,27 @@
 #define _PARSE_H_
 
 /* Function parse returns the newly 
- * constructed syntax tree
+ * constructed syntax tree; after a
+ * syntax error, the part of it parsed
+ * (see ctx->maxErrors)
  */
-TreeNode * parse(void);
+TreeNode * parse(CompilerContext *);
+
+/* Function lalrParse returns the same tree as parse,
+ * built by the LALR(1) parser of yacc/cminus.y. After
+ * a syntax error it returns what was parsed of the
+ * declarations so far; its errors are reported in
+ * the parser's own words.
+ */
+TreeNode * lalrParse(CompilerContext *);
+
+/* Function recognize checks the source with the
+ * grammar of parse but builds no tree. Returns 0 if
+ * it parses, otherwise the line of the first syntax
+ * error; ctx->tok then holds the offending token
+ * (see tokenText). The error is written to
+ * ctx->listing unless it is NULL.
+ */
+int recognize(CompilerContext *);
 
 #endif
@@ -0,0 +1,115 @@
+/****************************************************/
+/* File: parsebench.c                               */
+/* Parser benchmark: throughput and tree memory of  */
+/* the recursive-descent and the LALR(1) parsers    */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "parse.h"
+#include "source.h"
+#include "outbuf.h"
+#include "timing.h"
+#include "memstat.h"
+
+/* seconds of parsing per parser and file */
+#define MINTIME 0.5
+
+static const char *parserName[] = {"rd", "lalr"};
+
+/* parse sb once with ctx, scanning with the direct
+ * engine so the parsers share the same token source;
+ * returns the tree, which lives until the next parse
+ */
+static TreeNode *parseOnce(CompilerContext *ctx, SourceBuffer *sb,
+                           OutBuf *errors, double *secs)
+{
+  TreeNode *t;
+  double start;
+  resetContext(ctx);
+  ctx->source = sb;
+  ctx->listing = errors;
+  start = wallClock();
+  scanInit(ctx);
+  t = ctx->parserEngine == ParseLalr ? lalrParse(ctx) : parse(ctx);
+  scanRelease(ctx);
+  *secs += wallClock() - start;
+  return t;
+}
+
+/* the listing of tree t */
+static void listTree(CompilerContext *ctx, TreeNode *t, OutBuf *out)
+{
+  outInit(out, -1);
+  ctx->listing = out;
+  ctx->indentno = 0;
+  printTree(ctx, t);
+  ctx->listing = NULL;
+}
+
+int main(int argc, char *argv[])
+{
+  CompilerContext context, *ctx = &context;
+  MemStat mem;
+  int i, e;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s <filename>...\n", argv[0]);
+    return 1;
+  }
+  initContext(ctx);
+  ctx->scanEngine = ScanDirect;
+  ctx->memstat = &mem;
+  printf("%-24s %6s %10s %12s %10s %12s\n", "file", "parser", "parses/sec",
+         "MB/sec", "nodes", "tree bytes");
+  for (i = 1; i < argc; i++)
+  {
+    SourceBuffer sb;
+    OutBuf errors, listing[2];
+    if (!openSource(&sb, argv[i]))
+    {
+      fprintf(stderr, "cannot read %s\n", argv[i]);
+      return 1;
+    }
+    for (e = ParseRd; e <= ParseLalr; e++)
+    {
+      double secs = 0;
+      long passes = 0, nodes = 0;
+      size_t bytes = 0;
+      int s;
+      TreeNode *t;
+      ctx->parserEngine = (ParserEngine)e;
+      do
+      {
+        outInit(&errors, -1);
+        memStatInit(&mem);
+        t = parseOnce(ctx, &sb, &errors, &secs);
+        outFree(&errors);
+        passes++;
+      } while (secs < MINTIME);
+      /* the allocations of the last pass: the nodes
+       * and the names they point to
+       */
+      for (s = SiteStmtNode; s <= SiteArrSizeNode; s++)
+        nodes += mem.count[s];
+      for (s = SiteStmtNode; s <= SiteString; s++)
+        bytes += mem.bytes[s];
+      printf("%-24s %6s %10.1f %12.2f %10ld %12lu\n", argv[i], parserName[e],
+             passes / secs, sb.len * passes / secs / 1e6, nodes,
+             (unsigned long)bytes);
+      if (ctx->Error)
+        fprintf(stderr, "%s: syntax error (%s)\n", argv[i], parserName[e]);
+      listTree(ctx, t, &listing[e]);
+    }
+    if (listing[ParseRd].len != listing[ParseLalr].len ||
+        memcmp(listing[ParseRd].buf, listing[ParseLalr].buf, listing[ParseRd].len) != 0)
+      fprintf(stderr, "%s: the parsers disagree on the syntax tree\n", argv[i]);
+    outFree(&listing[ParseRd]);
+    outFree(&listing[ParseLalr]);
+    closeSource(&sb);
+  }
+  freeContext(ctx);
+  return 0;
+}
@@ -1,203 +1,329 @@
 /****************************************************/
 /* File: scan.c                                     */
-/* The scanner implementation for the TINY compiler */
+/* The scanner implementation for the C- compiler   */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
 
 #include "globals.h"
 #include "util.h"
+#include "outbuf.h"
 #include "scan.h"
+#include "timing.h"
+#include "tokpipe.h"
+#include "chunklex.h"
 
-/* states in scanner DFA */
-typedef enum
-   { START,INASSIGN,INCOMMENT,INNUM,INID,DONE }
-   StateType;
-
-/* lexeme of identifier or reserved word */
-char tokenString[MAXTOKENLEN+1];
-
-/* BUFLEN = length of the input buffer for
-   source code lines */
-#define BUFLEN 256
-
-static char lineBuf[BUFLEN]; /* holds the current line */
-static int linepos = 0; /* current position in LineBuf */
-static int bufsize = 0; /* current size of buffer string */
-static int EOF_flag = FALSE; /* corrects ungetNextChar behavior on EOF */
-
-/* getNextChar fetches the next non-blank character
-   from lineBuf, reading in a new line if lineBuf is
-   exhausted */
-static int getNextChar(void)
-{ if (!(linepos < bufsize))
-  { lineno++;
-    if (fgets(lineBuf,BUFLEN-1,source))
-    { if (EchoSource) fprintf(listing,"%4d: %s",lineno,lineBuf);
-      bufsize = strlen(lineBuf);
-      linepos = 0;
-      return lineBuf[linepos++];
-    }
-    else
-    { EOF_flag = TRUE;
-      return EOF;
-    }
+#include "simd.h"
+
+/* The direct engine (ScanDirect) scans ctx->source
+   in place with one cursor, ctx->scanPos. It
+   accepts exactly the tokens of lex/cminus.l:
+   runs of blanks, identifiers and numbers are
+   skipped 32 (AVX2) or 16 (SSE2) bytes at a time,
+   everything else a byte at a time. */
+
+static int isLetter(int c)
+{ return (unsigned)((c | 0x20) - 'a') < 26; }
+
+static int isDigit(int c)
+{ return (unsigned)(c - '0') < 10; }
+
+/* the vector fast paths (simd.h) work on whole
+   blocks of VLEN bytes; the last bytes before end
+   are left to the scalar loops. Most runs are
+   short, so the first SHORTRUN bytes are tested
+   one by one before a block is loaded. */
+#define SHORTRUN 8
+
+#ifdef VLEN
+/* bytes of v in lo..hi; the compares are signed,
+   so bytes >= 0x80 are never in an ASCII range */
+static Vec vrange(Vec v, char lo, char hi)
+{ return vand(vgt(v,vset(lo - 1)),vgt(vset(hi + 1),v)); }
+
+/* mask of the letters and digits in the block at p */
+static Mask alnumMask(const char *p)
+{ Vec v = vload(p);
+  return vmask(vor(vrange(vor(v,vset(0x20)),'a','z'),vrange(v,'0','9')));
+}
+#endif
+
+/* skipAlnum returns the end of the run of
+   letters and digits at p */
+static const char *skipAlnum(const char *p, const char *end)
+{ const char *q = end - p > SHORTRUN ? p + SHORTRUN : end;
+  while (p < q && (isLetter(*p) || isDigit(*p))) p++;
+  if (p < q) return p;
+#ifdef VLEN
+  while (end - p >= VLEN)
+  { Mask stop = ~alnumMask(p) & ALLSET;
+    if (stop) return p + __builtin_ctz(stop);
+    p += VLEN;
   }
-  else return lineBuf[linepos++];
+#endif
+  while (p < end && (isLetter(*p) || isDigit(*p))) p++;
+  return p;
 }
 
-/* ungetNextChar backtracks one character
-   in lineBuf */
-static void ungetNextChar(void)
-{ if (!EOF_flag) linepos-- ;}
+/* skipDigits returns the end of the run of
+   digits at p */
+static const char *skipDigits(const char *p, const char *end)
+{ const char *q = end - p > SHORTRUN ? p + SHORTRUN : end;
+  while (p < q && isDigit(*p)) p++;
+  if (p < q) return p;
+#ifdef VLEN
+  while (end - p >= VLEN)
+  { Mask stop = ~vmask(vrange(vload(p),'0','9')) & ALLSET;
+    if (stop) return p + __builtin_ctz(stop);
+    p += VLEN;
+  }
+#endif
+  while (p < end && isDigit(*p)) p++;
+  return p;
+}
+
+/* skipBlanks returns the end of the run of blanks,
+   tabs and newlines (\n or \r\n) at p. A lone \r
+   is not a blank. */
+static const char *skipBlanks(const char *p, const char *end)
+{ const char *q = end - p > SHORTRUN ? p + SHORTRUN : end;
+  while (p < q)
+  { if (*p == '\r' && (p + 1 == end || p[1] != '\n')) return p;
+    if (*p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') return p;
+    p++;
+  }
+#ifdef VLEN
+  /* p[VLEN] must exist for the \r\n test */
+  while (end - p > VLEN)
+  { Vec v = vload(p);
+    Vec crlf = vand(veq(v,vset('\r')),veq(vload(p + 1),vset('\n')));
+    Vec blank = vor(vor(veq(v,vset(' ')),veq(v,vset('\t'))),
+                    vor(veq(v,vset('\n')),crlf));
+    Mask stop = ~vmask(blank) & ALLSET;
+    if (stop) return p + __builtin_ctz(stop);
+    p += VLEN;
+  }
+#endif
+  while (p < end)
+  { if (*p == '\r' && (p + 1 == end || p[1] != '\n')) break;
+    if (*p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') break;
+    p++;
+  }
+  return p;
+}
+
+/* perfect hash of the reserved words: the first
+   two letters and the length pick the only slot
+   the word can be in */
+#define KEYHASH(c0,c1,n) ((((unsigned char)(c0)) ^ \
+                           ((unsigned char)(c1) << 1) ^ (n)) & 15)
 
-/* lookup table of reserved words */
-static struct
-    { char* str;
+static const struct
+    { const char *str;
+      int len;
       TokenType tok;
-    } reservedWords[MAXRESERVED]
-   = {{"if",IF},{"then",THEN},{"else",ELSE},{"end",END},
-      {"repeat",REPEAT},{"until",UNTIL},{"read",READ},
-      {"write",WRITE}};
+    } reservedWords[16]
+   = {[KEYHASH('i','f',2)] = {"if",2,IF},
+      [KEYHASH('e','l',4)] = {"else",4,ELSE},
+      [KEYHASH('i','n',3)] = {"int",3,INT},
+      [KEYHASH('r','e',6)] = {"return",6,RETURN},
+      [KEYHASH('v','o',4)] = {"void",4,VOID},
+      [KEYHASH('w','h',5)] = {"while",5,WHILE}};
 
 /* lookup an identifier to see if it is a reserved word */
-/* uses linear search */
-static TokenType reservedLookup (char * s)
-{ int i;
-  for (i=0;i<MAXRESERVED;i++)
-    if (!strcmp(s,reservedWords[i].str))
-      return reservedWords[i].tok;
+static TokenType reservedLookup(const char *s, int n)
+{ int h;
+  if (n < 2 || n > 6) return ID;
+  h = KEYHASH(s[0],s[1],n);
+  if (reservedWords[h].len == n && memcmp(reservedWords[h].str,s,n) == 0)
+    return reservedWords[h].tok;
   return ID;
 }
 
+TokenType scanBytes(const char *text, const char *end, const char **pos,
+                    int skipComments, TokenSpan *tok)
+{ const char *p = *pos;
+  const char *start;
+  TokenType currentToken;
+  do
+  { p = skipBlanks(p,end);
+    start = p;
+    if (p == end)
+      currentToken = ENDFILE;
+    else if (isLetter(*p))
+    { p = skipAlnum(p + 1,end);
+      currentToken = reservedLookup(start,p - start);
+    }
+    else if (isDigit(*p))
+    { p = skipDigits(p + 1,end);
+      currentToken = NUM;
+    }
+    else switch (*p++)
+    { case '=':
+        if (p < end && *p == '=') { p++; currentToken = EQ; }
+        else currentToken = ASSIGN;
+        break;
+      case '<':
+        if (p < end && *p == '=') { p++; currentToken = LTEQ; }
+        else currentToken = LT;
+        break;
+      case '>':
+        if (p < end && *p == '=') { p++; currentToken = GTEQ; }
+        else currentToken = GT;
+        break;
+      case '!':
+        if (p < end && *p == '=') { p++; currentToken = NOTEQ; }
+        else currentToken = ERROR;
+        break;
+      case ';': currentToken = SEMI; break;
+      case ',': currentToken = COMMA; break;
+      case '+': currentToken = PLUS; break;
+      case '-': currentToken = MINUS; break;
+      case '*': currentToken = TIMES; break;
+      case '(': currentToken = LPAREN; break;
+      case ')': currentToken = RPAREN; break;
+      case '{': currentToken = LBRACE; break;
+      case '}': currentToken = RBRACE; break;
+      case '[': currentToken = LBRACKET; break;
+      case ']': currentToken = RBRACKET; break;
+      case '/':
+        if (p < end && *p == '*')
+        { const char *q = p + 1;
+          const char *star;
+          currentToken = COMMENT_ERROR;
+          while ((star = memchr(q,'*',end - q)) != NULL)
+          { if (star + 1 < end && star[1] == '/')
+            { currentToken = COMMENT;
+              break;
+            }
+            q = star + 1;
+          }
+          p = currentToken == COMMENT ? star + 2 : end;
+        }
+        else currentToken = OVER;
+        break;
+      default: currentToken = ERROR; break;
+    }
+  } while (currentToken == COMMENT && skipComments);
+  *pos = p;
+  tok->kind = currentToken;
+  tok->offset = start - text;
+  tok->len = p - start;
+  return currentToken;
+}
+
+/* directToken scans the next token for ScanDirect;
+   comments are skipped here if ctx->skipComments */
+static TokenType directToken(CompilerContext *ctx)
+{ const char *text = ctx->source->text;
+  return scanBytes(text,text + ctx->source->len,&ctx->scanPos,
+                   ctx->skipComments,&ctx->tok);
+}
+
+TokenType rawToken(CompilerContext *ctx)
+{ return ctx->scanEngine == ScanDirect ? directToken(ctx) : flexToken(ctx);
+}
+
+/* Under --time-report tokens are scanned TIMEDBATCH
+   at a time, so that the clocks are read once per
+   batch rather than twice per token */
+#define TIMEDBATCH 1024
+
+typedef struct timedBatch
+{ TokenSpan tok[TIMEDBATCH];
+  int n;   /* tokens in tok */
+  int pos; /* index of the next one */
+} TimedBatch;
+
+/* the next token: from a token file, the chunks
+   lexed in parallel or the scanner thread when
+   there are any, else scanned right here */
+static TokenType nextToken(CompilerContext *ctx)
+{ if (ctx->tokens != NULL) return tokenFileToken(ctx);
+  if (ctx->chunks != NULL) return chunkToken(ctx);
+  return ctx->pipe != NULL ? pipeToken(ctx) : rawToken(ctx);
+}
+
+/* timedToken takes the next token from ctx->timed,
+   scanning the next batch when it is used up; the
+   scan time (or the wait for the scanner thread) of
+   a batch is added without a span. A batch stops
+   at ENDFILE. */
+static TokenType timedToken(CompilerContext *ctx)
+{ TimedBatch *b = ctx->timed;
+  if (b->pos == b->n)
+  { double wall = wallClock(), cpu = cpuClock();
+    b->n = b->pos = 0;
+    do
+    { nextToken(ctx);
+      b->tok[b->n++] = ctx->tok;
+    } while (ctx->tok.kind != ENDFILE && b->n < TIMEDBATCH);
+    ctx->timing->wall[PhaseScan] += wallClock() - wall;
+    ctx->timing->cpu[PhaseScan] += cpuClock() - cpu;
+  }
+  ctx->tok = b->tok[b->pos++];
+  return ctx->tok.kind;
+}
+
 /****************************************/
 /* the primary function of the scanner  */
 /****************************************/
-/* function getToken returns the 
+/* function getToken returns the
  * next token in source file
  */
-TokenType getToken(void)
-{  /* index for storing into tokenString */
-   int tokenStringIndex = 0;
-   /* holds current token to be returned */
-   TokenType currentToken;
-   /* current state - always begins at START */
-   StateType state = START;
-   /* flag to indicate save to tokenString */
-   int save;
-   while (state != DONE)
-   { int c = getNextChar();
-     save = TRUE;
-     switch (state)
-     { case START:
-         if (isdigit(c))
-           state = INNUM;
-         else if (isalpha(c))
-           state = INID;
-         else if (c == ':')
-           state = INASSIGN;
-         else if ((c == ' ') || (c == '\t') || (c == '\n'))
-           save = FALSE;
-         else if (c == '{')
-         { save = FALSE;
-           state = INCOMMENT;
-         }
-         else
-         { state = DONE;
-           switch (c)
-           { case EOF:
-               save = FALSE;
-               currentToken = ENDFILE;
-               break;
-             case '=':
-               currentToken = EQ;
-               break;
-             case '<':
-               currentToken = LT;
-               break;
-             case '+':
-               currentToken = PLUS;
-               break;
-             case '-':
-               currentToken = MINUS;
-               break;
-             case '*':
-               currentToken = TIMES;
-               break;
-             case '/':
-               currentToken = OVER;
-               break;
-             case '(':
-               currentToken = LPAREN;
-               break;
-             case ')':
-               currentToken = RPAREN;
-               break;
-             case ';':
-               currentToken = SEMI;
-               break;
-             default:
-               currentToken = ERROR;
-               break;
-           }
-         }
-         break;
-       case INCOMMENT:
-         save = FALSE;
-         if (c == EOF)
-         { state = DONE;
-           currentToken = ENDFILE;
-         }
-         else if (c == '}') state = START;
-         break;
-       case INASSIGN:
-         state = DONE;
-         if (c == '=')
-           currentToken = ASSIGN;
-         else
-         { /* backup in the input */
-           ungetNextChar();
-           save = FALSE;
-           currentToken = ERROR;
-         }
-         break;
-       case INNUM:
-         if (!isdigit(c))
-         { /* backup in the input */
-           ungetNextChar();
-           save = FALSE;
-           state = DONE;
-           currentToken = NUM;
-         }
-         break;
-       case INID:
-         if (!isalpha(c))
-         { /* backup in the input */
-           ungetNextChar();
-           save = FALSE;
-           state = DONE;
-           currentToken = ID;
-         }
-         break;
-       case DONE:
-       default: /* should never happen */
-         fprintf(listing,"Scanner Bug: state= %d\n",state);
-         state = DONE;
-         currentToken = ERROR;
-         break;
-     }
-     if ((save) && (tokenStringIndex <= MAXTOKENLEN))
-       tokenString[tokenStringIndex++] = (char) c;
-     if (state == DONE)
-     { tokenString[tokenStringIndex] = '\0';
-       if (currentToken == ID)
-         currentToken = reservedLookup(tokenString);
-     }
-   }
-   if (TraceScan) {
-     fprintf(listing,"\t%d: ",lineno);
-     printToken(currentToken,tokenString);
-   }
-   return currentToken;
+TokenType getToken(CompilerContext *ctx)
+{ TokenType currentToken;
+  if (ctx->timed != NULL)
+    currentToken = timedToken(ctx);
+  else
+    currentToken = nextToken(ctx);
+  if (ctx->TraceScan && ctx->listing != NULL) {
+    outPrintf(ctx->listing,"\t%d: ",currentLine(ctx));
+    printToken(ctx,currentToken,tokenText(ctx));
+  }
+  return currentToken;
 } /* end getToken */
 
+void scanInit(CompilerContext *ctx)
+{ if (ctx->timing == NULL)
+  { free(ctx->timed);
+    ctx->timed = NULL;
+  }
+  else if (ctx->timed == NULL)
+    ctx->timed = (TimedBatch *)calloc(1,sizeof(TimedBatch));
+  if (ctx->timed != NULL)
+    ctx->timed->n = ctx->timed->pos = 0;
+  /* tokens read back from a token file need no
+     scanning; large sources are lexed up front, in
+     parallel; without a scanner thread either, scan
+     here */
+  if (ctx->tokens != NULL)
+    return;
+  if (ctx->lexThreads > 1 && chunkLex(ctx,ctx->lexThreads))
+    return;
+  if (ctx->pipelineScan && pipeStart(ctx))
+    return;
+  if (ctx->scanEngine == ScanDirect)
+    ctx->scanPos = ctx->source->text;
+  else
+    flexInit(ctx);
+}
+
+void scanRelease(CompilerContext *ctx)
+{ if (ctx->tokens != NULL)
+    closeTokenFile(ctx);
+  else if (ctx->chunks != NULL)
+    chunkFree(ctx);
+  else if (ctx->pipe != NULL)
+    pipeStop(ctx);
+  else if (ctx->scanEngine == ScanDirect)
+    ctx->scanPos = NULL;
+  else
+    flexRelease(ctx);
+}
+
+void scanDone(CompilerContext *ctx)
+{ free(ctx->timed);
+  ctx->timed = NULL;
+  flexDone(ctx);
+}
@@ -1,6 +1,6 @@
 /****************************************************/
 /* File: scan.h                                     */
-/* The scanner interface for the TINY compiler      */
+/* The scanner interface for the C- compiler        */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
@@ -8,15 +8,50 @@
 #ifndef _SCAN_H_
 #define _SCAN_H_
 
-/* MAXTOKENLEN is the maximum size of a token */
-#define MAXTOKENLEN 40
+/* function getToken returns the 
+ * next token in source file; its span
+ * is left in ctx->tok. ctx->scanEngine
+ * picks the scanner that finds it.
+ */
+TokenType getToken(CompilerContext *);
+
+/* Procedure scanInit attaches the scanner of ctx
+ * (creating it on first use) to ctx->source,
+ * which is scanned in place
+ */
+void scanInit(CompilerContext *);
 
-/* tokenString array stores the lexeme of each token */
-extern char tokenString[MAXTOKENLEN+1];
+/* Procedure scanRelease detaches ctx->source from
+ * the scanner, which is kept for the next source
+ */
+void scanRelease(CompilerContext *);
 
-/* function getToken returns the 
- * next token in source file
+/* Procedure scanDone releases the scanner
+ * created by scanInit
+ */
+void scanDone(CompilerContext *);
+
+/* Function rawToken returns the next token of
+ * the engine of ctx, without timing or tracing;
+ * the scanner thread (tokpipe.c) calls it
+ */
+TokenType rawToken(CompilerContext *);
+
+/* Function scanBytes scans the token at *pos with
+ * the rules of the direct engine, which accepts the
+ * tokens of lex/cminus.l, stopping at end. The span
+ * is left in *tok, relative to text, and *pos is
+ * advanced past it; ENDFILE is returned at end.
+ */
+TokenType scanBytes(const char *text, const char *end, const char **pos,
+                    int skipComments, TokenSpan *tok);
+
+/* the flex engine, lex/cminus.l; only scan.c
+ * calls these
  */
-TokenType getToken(void);
+TokenType flexToken(CompilerContext *);
+void flexInit(CompilerContext *);
+void flexRelease(CompilerContext *);
+void flexDone(CompilerContext *);
 
 #endif
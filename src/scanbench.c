@@ -0,0 +1,84 @@
+/****************************************************/
+/* File: scanbench.c                                */
+/* Scanner benchmark: tokens per second of the      */
+/* flex and the direct scanner engines              */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "source.h"
+#include "timing.h"
+
+/* seconds of scanning per engine and file */
+#define MINTIME 0.5
+
+static const char *engineName[] = {"flex", "direct"};
+
+/* scan sb once with ctx; returns the number of tokens.
+ * flex writes into its buffer while scanning, so sb is
+ * refilled from the pristine text first (untimed).
+ */
+static long scanOnce(CompilerContext *ctx, SourceBuffer *sb,
+                     const char *text, double *secs)
+{
+  long ntokens = 0;
+  double start;
+  memcpy(sb->text, text, sb->len);
+  resetContext(ctx);
+  ctx->source = sb;
+  start = wallClock();
+  scanInit(ctx);
+  while (getToken(ctx) != ENDFILE)
+    ntokens++;
+  scanRelease(ctx);
+  *secs += wallClock() - start;
+  return ntokens;
+}
+
+int main(int argc, char *argv[])
+{
+  CompilerContext context, *ctx = &context;
+  int i, e;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s <filename>...\n", argv[0]);
+    return 1;
+  }
+  initContext(ctx);
+  ctx->TraceParse = FALSE;
+  printf("%-24s %8s %10s %14s\n", "file", "engine", "tokens", "tokens/sec");
+  for (i = 1; i < argc; i++)
+  {
+    SourceBuffer sb;
+    char *text;
+    long ntokens[2];
+    if (!openSource(&sb, argv[i]))
+    {
+      fprintf(stderr, "cannot read %s\n", argv[i]);
+      return 1;
+    }
+    text = (char *)malloc(sb.len);
+    memcpy(text, sb.text, sb.len);
+    for (e = ScanFlex; e <= ScanDirect; e++)
+    {
+      double secs = 0;
+      long passes = 0;
+      ctx->scanEngine = (ScanEngine)e;
+      do
+      {
+        ntokens[e] = scanOnce(ctx, &sb, text, &secs);
+        passes++;
+      } while (secs < MINTIME);
+      printf("%-24s %8s %10ld %14.0f\n", argv[i], engineName[e], ntokens[e],
+             ntokens[e] * passes / secs);
+    }
+    if (ntokens[ScanFlex] != ntokens[ScanDirect])
+      fprintf(stderr, "%s: the engines disagree on the number of tokens\n", argv[i]);
+    free(text);
+    closeSource(&sb);
+  }
+  freeContext(ctx);
+  return 0;
+}
@@ -0,0 +1,264 @@
+/****************************************************/
+/* File: server.c                                   */
+/* Persistent compile server (hw2_binary --server)  */
+/****************************************************/
+
+#define _GNU_SOURCE /* struct ucred */
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "source.h"
+#include "compile.h"
+#include "server.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+/* MAXSERVERTHREADS is the maximum number of worker threads */
+#define MAXSERVERTHREADS 256
+
+static int listenFd = -1;
+static const char *socketPath;
+static CompileCache *serverCache;
+
+/* remove the socket file when the server is stopped */
+static void stopServer(int sig)
+{
+  (void)sig;
+  unlink(socketPath);
+  _exit(0);
+}
+
+/* send a response header followed by its listing and code */
+static int sendResponse(int fd, int status, CminusResult *result)
+{
+  ServerResponse resp;
+  struct iovec iov[3];
+  size_t total, done = 0;
+  int i = 0;
+
+  resp.magic = SERVER_MAGIC;
+  resp.status = status;
+  resp.listingLen = result ? result->listingLen : 0;
+  resp.codeLen = result ? result->codeLen : 0;
+  iov[0].iov_base = &resp;
+  iov[0].iov_len = sizeof(resp);
+  iov[1].iov_base = result ? result->listing : NULL;
+  iov[1].iov_len = resp.listingLen;
+  iov[2].iov_base = result ? result->code : NULL;
+  iov[2].iov_len = resp.codeLen;
+  total = sizeof(resp) + resp.listingLen + resp.codeLen;
+
+  /* one writev in the common case */
+  while (done < total)
+  {
+    ssize_t n = writev(fd, iov + i, 3 - i);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return FALSE;
+    done += n;
+    while (i < 3 && (size_t)n >= iov[i].iov_len)
+    {
+      n -= iov[i].iov_len;
+      i++;
+    }
+    if (i < 3)
+    {
+      iov[i].iov_base = (char *)iov[i].iov_base + n;
+      iov[i].iov_len -= n;
+    }
+  }
+  return TRUE;
+}
+
+/* TRUE if the client on connection fd runs as the
+ * user of the server
+ */
+static int peerIsOwner(int fd)
+{
+  struct ucred cred;
+  socklen_t len = sizeof(cred);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0)
+    return FALSE;
+  return cred.uid == geteuid();
+}
+
+/* serve every request on connection fd; ctx belongs
+ * to the worker and stays warm across requests. Paths
+ * are only opened for a client that is the owner.
+ */
+static void serveConnection(CompilerContext *ctx, int fd, int owner)
+{
+  ServerRequest req;
+  char name[MAXNAME + 1];
+
+  while (readFully(fd, &req, sizeof(req)))
+  {
+    SourceBuffer sb;
+    CminusResult result;
+    CacheKey key;
+    int status, hit, compiled;
+
+    if (req.magic != SERVER_MAGIC || req.nameLen > MAXNAME ||
+        req.dataLen > MAXREQUEST ||
+        ((req.flags & REQ_READ_FILE) && req.dataLen > MAXPATH))
+    {
+      sendResponse(fd, RESP_FAILED, NULL);
+      return;
+    }
+    if (!readFully(fd, name, req.nameLen))
+      return;
+    name[req.nameLen] = '\0';
+
+    if (req.flags & REQ_READ_FILE)
+    {
+      char path[MAXPATH + 1];
+      if (!readFully(fd, path, req.dataLen))
+        return;
+      path[req.dataLen] = '\0';
+      if (!owner)
+      {
+        if (!sendResponse(fd, RESP_DENIED, NULL))
+          return;
+        continue;
+      }
+      if (!openSource(&sb, path))
+      {
+        if (!sendResponse(fd, RESP_NOFILE, NULL))
+          return;
+        continue;
+      }
+    }
+    else
+    {
+      /* receive the source straight into a scanner buffer */
+      memset(&sb, 0, sizeof(SourceBuffer));
+      sb.text = (char *)malloc(req.dataLen + 2);
+      if (sb.text == NULL)
+      {
+        sendResponse(fd, RESP_FAILED, NULL);
+        return;
+      }
+      if (!readFully(fd, sb.text, req.dataLen))
+      {
+        free(sb.text);
+        return;
+      }
+      sb.text[req.dataLen] = sb.text[req.dataLen + 1] = '\0';
+      sb.len = req.dataLen;
+      sb.size = req.dataLen + 2;
+      sb.mapped = FALSE;
+    }
+
+    ctx->EchoSource = (req.flags & REQ_ECHO_SOURCE) != 0;
+    ctx->TraceScan = (req.flags & REQ_TRACE_SCAN) != 0;
+    ctx->TraceParse = (req.flags & REQ_TRACE_PARSE) != 0;
+    ctx->TraceAnalyze = (req.flags & REQ_TRACE_ANALYZE) != 0;
+    ctx->TraceCode = (req.flags & REQ_TRACE_CODE) != 0;
+
+    hit = FALSE;
+    if (serverCache != NULL)
+    {
+      cacheKey(key, sb.text, sb.len, name, compileFlags(ctx));
+      hit = cacheLookup(serverCache, key, &result);
+    }
+    compiled = hit || compileToMemory(ctx, &sb, name, &result) == 0;
+    if (compiled && !hit && serverCache != NULL)
+      cacheStore(serverCache, key, &result);
+
+    if (!compiled)
+      status = sendResponse(fd, RESP_FAILED, NULL);
+    else
+    {
+      status = sendResponse(fd, result.error ? RESP_ERROR : RESP_OK, &result);
+      cminusFreeResult(&result);
+    }
+    closeSource(&sb);
+    if (!status)
+      return;
+  }
+}
+
+/* worker thread: accept connections until the server stops */
+static void *serverWorker(void *arg)
+{
+  CompilerContext context, *ctx = &context;
+  (void)arg;
+  initContext(ctx);
+  for (;;)
+  {
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd < 0)
+    {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      break;
+    }
+    serveConnection(ctx, fd, peerIsOwner(fd));
+    close(fd);
+  }
+  freeContext(ctx);
+  return NULL;
+}
+
+int runServer(const char *path, int nthreads, CompileCache *cache)
+{
+  struct sockaddr_un addr;
+  pthread_t threads[MAXSERVERTHREADS];
+  mode_t mask;
+  int i;
+
+  if (nthreads < 1)
+    nthreads = 1;
+  if (nthreads > MAXSERVERTHREADS)
+    nthreads = MAXSERVERTHREADS;
+  if (strlen(path) >= sizeof(addr.sun_path))
+  {
+    fprintf(stderr, "socket path too long: %s\n", path);
+    return FALSE;
+  }
+
+  listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenFd < 0)
+  {
+    perror("socket");
+    return FALSE;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  unlink(path);
+  /* only this user may connect: the socket is made mode 0600 */
+  mask = umask(0177);
+  i = bind(listenFd, (struct sockaddr *)&addr, sizeof(addr));
+  umask(mask);
+  if (i < 0 || chmod(path, 0600) < 0 || listen(listenFd, 128) < 0)
+  {
+    perror(path);
+    close(listenFd);
+    return FALSE;
+  }
+
+  socketPath = path;
+  serverCache = cache;
+  signal(SIGINT, stopServer);
+  signal(SIGTERM, stopServer);
+  signal(SIGPIPE, SIG_IGN);
+  printf("server listening on %s with %d threads\n", path, nthreads);
+  fflush(stdout);
+
+  for (i = 0; i < nthreads; i++)
+    pthread_create(&threads[i], NULL, serverWorker, NULL);
+  for (i = 0; i < nthreads; i++)
+    pthread_join(threads[i], NULL);
+
+  close(listenFd);
+  unlink(path);
+  return TRUE;
+}
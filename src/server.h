@@ -0,0 +1,112 @@
+/****************************************************/
+/* File: server.h                                   */
+/* Compile server protocol: hw2_binary --server     */
+/* listens on a Unix domain socket and hw2_client   */
+/* sends it compile requests                        */
+/****************************************************/
+
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cache.h"
+
+/* name of the socket used when none is given on the
+ * command line; it lives in $XDG_RUNTIME_DIR or else in
+ * the private directory /tmp/cminus-<uid>
+ */
+#define SOCKET_NAME "cminus.sock"
+
+/* MAXSOCKETPATH is the size of sun_path, the longest
+ * socket path with its terminating NUL
+ */
+#define MAXSOCKETPATH 108
+
+/* MAXNAME is the maximum length of a source file name,
+ * the same for hw2_binary and hw2_client; MAXPATH that
+ * of the path sent with REQ_READ_FILE
+ */
+#define MAXNAME 255
+#define MAXPATH 4096
+
+/* first word of every request and response */
+#define SERVER_MAGIC 0x31534d43 /* "CMS1" */
+
+/* MAXREQUEST is the largest source accepted by the server */
+#define MAXREQUEST (256 * 1024 * 1024)
+
+/* request flags: the tracing flags of the compilation */
+#define REQ_ECHO_SOURCE 0x01
+#define REQ_TRACE_SCAN 0x02
+#define REQ_TRACE_PARSE 0x04
+#define REQ_TRACE_ANALYZE 0x08
+#define REQ_TRACE_CODE 0x10
+/* the data is a path that the server reads itself; only
+ * honored for clients running as the server's own user
+ */
+#define REQ_READ_FILE 0x100
+
+/* A request is followed by nameLen bytes of program
+ * name (printed in the listing header) and dataLen
+ * bytes of source text, or of a path if REQ_READ_FILE
+ * is set. A connection may carry any number of them.
+ */
+typedef struct
+{
+   uint32_t magic;
+   uint32_t flags;
+   uint32_t nameLen;
+   uint32_t dataLen;
+} ServerRequest;
+
+/* response status */
+#define RESP_OK 0
+#define RESP_ERROR 1   /* the program has syntax or type errors */
+#define RESP_NOFILE 2  /* REQ_READ_FILE: the file could not be read */
+#define RESP_FAILED 3  /* malformed request or out of memory */
+#define RESP_DENIED 4  /* REQ_READ_FILE from another user */
+
+/* A response is followed by listingLen bytes of
+ * listing and codeLen bytes of TM code.
+ */
+typedef struct
+{
+   uint32_t magic;
+   uint32_t status;
+   uint32_t listingLen;
+   uint32_t codeLen;
+} ServerResponse;
+
+/* Function runServer serves compile requests on the
+ * Unix socket at path with nthreads worker threads,
+ * looking them up in cache first unless it is NULL.
+ * Returns only if the socket cannot be set up.
+ */
+int runServer(const char *path, int nthreads, CompileCache *cache);
+
+/* Function defaultSocket writes the path of the
+ * default socket to buf, first creating its private
+ * directory if create is TRUE. Returns FALSE if the
+ * directory is missing or not private to this user,
+ * or the path does not fit in size bytes.
+ */
+int defaultSocket(char *buf, size_t size, int create);
+
+/* Function nameStem returns the length of name less
+ * the extension of its last path component: the part
+ * the listing, code and token file names are built on
+ */
+int nameStem(const char *name);
+
+/* Function readFully reads exactly len bytes from
+ * fd. Returns FALSE on EOF or error.
+ */
+int readFully(int fd, void *buf, size_t len);
+
+/* Function writeFully writes exactly len bytes to
+ * fd. Returns FALSE on error.
+ */
+int writeFully(int fd, const void *buf, size_t len);
+
+#endif
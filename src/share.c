@@ -0,0 +1,143 @@
+/****************************************************/
+/* File: share.c                                    */
+/* Shared leaf nodes: one immutable node per type   */
+/* and per array size in each compilation           */
+/****************************************************/
+
+#include "globals.h"
+#include "share.h"
+
+/* INITSLOTS is the initial size of the hash table;
+ * it must be a power of two. shareReset shrinks a
+ * table grown past MAXKEPTSLOTS back to it.
+ */
+#define INITSLOTS 64
+#define MAXKEPTSLOTS (INITSLOTS * 64)
+
+typedef struct shareTable
+{
+  TreeNode **slot; /* NULL if free */
+  unsigned mask;   /* slots - 1 */
+  int count;       /* slots taken */
+} ShareTable;
+
+/* the value a shared node is found by */
+static int keyOf(TreeNode *t)
+{
+  return t->nodekind == TypeK ? (int)t->type : t->arr_size;
+}
+
+static unsigned hashKey(NodeKind nk, int key)
+{
+  unsigned h = (unsigned)key * 2654435761u;
+  return h ^ (unsigned)nk * 40503u;
+}
+
+static ShareTable *table(CompilerContext *ctx)
+{
+  ShareTable *t = ctx->shared;
+  if (t == NULL)
+  {
+    t = (ShareTable *)calloc(1, sizeof(ShareTable));
+    if (t == NULL)
+      return NULL;
+    t->slot = (TreeNode **)calloc(INITSLOTS, sizeof(TreeNode *));
+    if (t->slot == NULL)
+    {
+      free(t);
+      return NULL;
+    }
+    t->mask = INITSLOTS - 1;
+    ctx->shared = t;
+  }
+  return t;
+}
+
+/* double the hash table */
+static int grow(ShareTable *t)
+{
+  unsigned n = (t->mask + 1) * 2, i;
+  TreeNode **slot = (TreeNode **)calloc(n, sizeof(TreeNode *));
+  if (slot == NULL)
+    return FALSE;
+  for (i = 0; i <= t->mask; i++)
+    if (t->slot[i] != NULL)
+    {
+      TreeNode *p = t->slot[i];
+      unsigned j = hashKey(p->nodekind, keyOf(p)) & (n - 1);
+      while (slot[j] != NULL)
+        j = (j + 1) & (n - 1);
+      slot[j] = p;
+    }
+  free(t->slot);
+  t->slot = slot;
+  t->mask = n - 1;
+  return TRUE;
+}
+
+/* the slot of the node, or the free slot it goes in */
+static TreeNode **find(ShareTable *t, NodeKind nk, int key)
+{
+  unsigned i;
+  for (i = hashKey(nk, key) & t->mask; t->slot[i] != NULL; i = (i + 1) & t->mask)
+  {
+    TreeNode *p = t->slot[i];
+    if (p->nodekind == nk && keyOf(p) == key)
+      break;
+  }
+  return &t->slot[i];
+}
+
+TreeNode **sharedSlot(CompilerContext *ctx, NodeKind nk, int key)
+{
+  ShareTable *t = table(ctx);
+  TreeNode **slot;
+
+  if (t == NULL)
+    return NULL;
+  slot = find(t, nk, key);
+  if (*slot != NULL)
+    return slot;
+
+  /* a new node: keep the table at most half full */
+  if ((unsigned)(t->count + 1) * 2 > t->mask + 1)
+  {
+    if (!grow(t))
+      return NULL;
+    slot = find(t, nk, key);
+  }
+  t->count++;
+  return slot;
+}
+
+void shareReset(CompilerContext *ctx)
+{
+  ShareTable *t = ctx->shared;
+  if (t == NULL || t->count == 0)
+    return;
+  if (t->mask + 1 > MAXKEPTSLOTS)
+  {
+    TreeNode **slot = (TreeNode **)calloc(MAXKEPTSLOTS, sizeof(TreeNode *));
+    if (slot != NULL)
+    {
+      free(t->slot);
+      t->slot = slot;
+      t->mask = MAXKEPTSLOTS - 1;
+    }
+    else
+      memset(t->slot, 0, (t->mask + 1) * sizeof(TreeNode *));
+  }
+  else
+    memset(t->slot, 0, (t->mask + 1) * sizeof(TreeNode *));
+  t->count = 0;
+}
+
+void shareFree(CompilerContext *ctx)
+{
+  ShareTable *t = ctx->shared;
+  if (t == NULL)
+    return;
+  free(t->slot);
+  free(t);
+  ctx->shared = NULL;
+}
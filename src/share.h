@@ -0,0 +1,33 @@
+/****************************************************/
+/* File: share.h                                    */
+/* Shared leaf nodes: one immutable node per type   */
+/* and per array size in each compilation           */
+/****************************************************/
+
+#ifndef _SHARE_H_
+#define _SHARE_H_
+
+/* Function sharedSlot returns the slot of the
+ * shared leaf of nodekind nk (TypeK or ArrSizeK)
+ * and value key: the type of a TypeK node or the
+ * size of an ArrSizeK node. If *slot is NULL there
+ * is no such node yet and the caller stores the new
+ * one there. Returns NULL if out of memory.
+ *
+ * Only these leaves are shared: they are never
+ * linked to a sibling or changed by a later pass,
+ * and their position is never reported. Constants
+ * and operators carry the offset of each occurrence
+ * and get a type from typeCheck, so they are not.
+ */
+TreeNode **sharedSlot(CompilerContext *ctx, NodeKind nk, int key);
+
+/* Procedure shareReset forgets the shared nodes of
+ * ctx; they live in its arena and go with it
+ */
+void shareReset(CompilerContext *ctx);
+
+/* Procedure shareFree releases the table of ctx */
+void shareFree(CompilerContext *ctx);
+
+#endif
@@ -0,0 +1,46 @@
+/****************************************************/
+/* File: simd.h                                     */
+/* Byte-block primitives for the scanner and the    */
+/* line table: 32 bytes at a time with AVX2, 16     */
+/* with SSE2, and VLEN undefined without either     */
+/****************************************************/
+
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Mask has one bit per byte of a block, bit i for
+ * byte i; __builtin_ctz finds the first set byte
+ */
+#if defined(__AVX2__)
+#define VLEN 32
+typedef __m256i Vec;
+typedef unsigned int Mask;
+#define vload(p) _mm256_loadu_si256((const __m256i *)(p))
+#define vset(c) _mm256_set1_epi8(c)
+#define veq(a,b) _mm256_cmpeq_epi8(a,b)
+#define vgt(a,b) _mm256_cmpgt_epi8(a,b)
+#define vand(a,b) _mm256_and_si256(a,b)
+#define vor(a,b) _mm256_or_si256(a,b)
+#define vmask(v) ((Mask)_mm256_movemask_epi8(v))
+#define ALLSET 0xffffffffu
+#elif defined(__SSE2__)
+#define VLEN 16
+typedef __m128i Vec;
+typedef unsigned int Mask;
+#define vload(p) _mm_loadu_si128((const __m128i *)(p))
+#define vset(c) _mm_set1_epi8(c)
+#define veq(a,b) _mm_cmpeq_epi8(a,b)
+#define vgt(a,b) _mm_cmpgt_epi8(a,b)
+#define vand(a,b) _mm_and_si128(a,b)
+#define vor(a,b) _mm_or_si128(a,b)
+#define vmask(v) ((Mask)_mm_movemask_epi8(v))
+#define ALLSET 0xffffu
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+/****************************************************/
+/* File: sockio.c                                   */
+/* Socket I/O and file name helpers shared by the  */
+/* compile server and hw2_client                    */
+/****************************************************/
+
+#include "globals.h"
+#include "server.h"
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+int nameStem(const char *name)
+{
+  const char *base = strrchr(name, '/');
+  const char *dot = strrchr(base != NULL ? base + 1 : name, '.');
+  return dot != NULL ? (int)(dot - name) : (int)strlen(name);
+}
+
+int defaultSocket(char *buf, size_t size, int create)
+{
+  const char *dir = getenv("XDG_RUNTIME_DIR");
+  char tmpdir[64];
+  struct stat st;
+
+  if (dir == NULL || dir[0] == '\0')
+  {
+    /* no runtime directory: one of our own under /tmp */
+    snprintf(tmpdir, sizeof(tmpdir), "/tmp/cminus-%lu", (unsigned long)geteuid());
+    dir = tmpdir;
+    if (create && mkdir(dir, 0700) < 0 && errno != EEXIST)
+    {
+      perror(dir);
+      return FALSE;
+    }
+  }
+  if (lstat(dir, &st) < 0)
+  {
+    perror(dir);
+    return FALSE;
+  }
+  /* nobody else may own or enter it */
+  if (!S_ISDIR(st.st_mode) || st.st_uid != geteuid() || (st.st_mode & 077) != 0)
+  {
+    fprintf(stderr, "%s is not a private directory\n", dir);
+    return FALSE;
+  }
+  if (snprintf(buf, size, "%s/%s", dir, SOCKET_NAME) >= (int)size)
+  {
+    fprintf(stderr, "socket path too long: %s/%s\n", dir, SOCKET_NAME);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+int readFully(int fd, void *buf, size_t len)
+{
+  char *p = (char *)buf;
+  while (len > 0)
+  {
+    ssize_t n = read(fd, p, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return FALSE;
+    p += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+int writeFully(int fd, const void *buf, size_t len)
+{
+  const char *p = (const char *)buf;
+  while (len > 0)
+  {
+    ssize_t n = write(fd, p, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return FALSE;
+    p += n;
+    len -= n;
+  }
+  return TRUE;
+}
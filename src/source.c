@@ -0,0 +1,192 @@
+/****************************************************/
+/* File: source.c                                   */
+/* Source input layer: the whole source file is     */
+/* mapped (or read with one syscall) into memory    */
+/****************************************************/
+
+#include "globals.h"
+#include "source.h"
+#include "simd.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* files smaller than MMAP_THRESHOLD bytes are read
+ * into a heap buffer: for them a single read() is
+ * cheaper than setting up and faulting in a mapping
+ */
+#define MMAP_THRESHOLD (64 * 1024)
+
+/* read len bytes of fd into a new buffer followed
+ * by the two NUL bytes the scanner needs
+ */
+static int readSource(SourceBuffer *sb, int fd, size_t len)
+{
+  size_t done = 0;
+  sb->text = (char *)malloc(len + 2);
+  if (sb->text == NULL)
+    return FALSE;
+  while (done < len)
+  {
+    ssize_t n = read(fd, sb->text + done, len - done);
+    if (n <= 0)
+    {
+      free(sb->text);
+      sb->text = NULL;
+      return FALSE;
+    }
+    done += n;
+  }
+  sb->text[len] = sb->text[len + 1] = '\0';
+  sb->len = len;
+  sb->size = len + 2;
+  sb->mapped = FALSE;
+  return TRUE;
+}
+
+int openSource(SourceBuffer *sb, const char *path)
+{
+  struct stat st;
+  long pagesize = sysconf(_SC_PAGESIZE);
+  size_t len;
+  int ok;
+  int fd = open(path, O_RDONLY);
+
+  memset(sb, 0, sizeof(SourceBuffer));
+  if (fd < 0)
+    return FALSE;
+  if (fstat(fd, &st) < 0)
+  {
+    close(fd);
+    return FALSE;
+  }
+  len = st.st_size;
+
+  /* The bytes between the end of the file and the end
+   * of its last page read as zeros, so a mapping of
+   * len + 2 bytes already ends in the two NULs when
+   * they fit in that page. The mapping is private and
+   * writable because the scanner temporarily stores a
+   * NUL after each lexeme.
+   */
+  if (len >= MMAP_THRESHOLD && pagesize - (long)(len % pagesize) >= 2 &&
+      len % pagesize != 0)
+  {
+    void *p = mmap(NULL, len + 2, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED)
+    {
+      madvise(p, len + 2, MADV_SEQUENTIAL);
+      sb->text = (char *)p;
+      sb->len = len;
+      sb->size = len + 2;
+      sb->mapped = TRUE;
+      close(fd);
+      return TRUE;
+    }
+  }
+
+  ok = readSource(sb, fd, len);
+  close(fd);
+  return ok;
+}
+
+int sourceFromBytes(SourceBuffer *sb, const char *bytes, size_t len)
+{
+  memset(sb, 0, sizeof(SourceBuffer));
+  sb->text = (char *)malloc(len + 2);
+  if (sb->text == NULL)
+    return FALSE;
+  memcpy(sb->text, bytes, len);
+  sb->text[len] = sb->text[len + 1] = '\0';
+  sb->len = len;
+  sb->size = len + 2;
+  sb->mapped = FALSE;
+  return TRUE;
+}
+
+/* add the offset of a \n to the newline index */
+static int addNewline(SourceBuffer *sb, size_t offset)
+{
+  if (sb->nnewlines == sb->maxnewlines)
+  {
+    int max = sb->maxnewlines ? sb->maxnewlines * 2 : 1024;
+    size_t *p = (size_t *)realloc(sb->newlines, max * sizeof(size_t));
+    if (p == NULL)
+      return FALSE;
+    sb->newlines = p;
+    sb->maxnewlines = max;
+  }
+  sb->newlines[sb->nnewlines++] = offset;
+  return TRUE;
+}
+
+/* extend the newline index of sb to text[0..to) */
+static void indexNewlines(SourceBuffer *sb, size_t to)
+{
+  size_t i = sb->indexed;
+  if (to > sb->len)
+    to = sb->len;
+#ifdef VLEN
+  for (; i + VLEN <= to; i += VLEN)
+  {
+    Mask m = vmask(veq(vload(sb->text + i), vset('\n')));
+    while (m)
+    {
+      if (!addNewline(sb, i + __builtin_ctz(m)))
+        return;
+      m &= m - 1;
+    }
+    sb->indexed = i + VLEN;
+  }
+#endif
+  for (; i < to; i++)
+  {
+    if (sb->text[i] == '\n' && !addNewline(sb, i))
+      return;
+    sb->indexed = i + 1;
+  }
+}
+
+/* Function newlinesBefore returns the number of
+ * \n bytes in text[0..offset)
+ */
+static int newlinesBefore(SourceBuffer *sb, size_t offset)
+{
+  int lo = 0, hi;
+  if (offset > sb->indexed)
+    indexNewlines(sb, offset);
+  hi = sb->nnewlines;
+  while (lo < hi)
+  {
+    int mid = lo + (hi - lo) / 2;
+    if (sb->newlines[mid] < offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+int lineOf(SourceBuffer *sb, size_t offset)
+{
+  return newlinesBefore(sb, offset) + 1;
+}
+
+int columnOf(SourceBuffer *sb, size_t offset)
+{
+  int n = newlinesBefore(sb, offset);
+  return n == 0 ? (int)offset + 1 : (int)(offset - sb->newlines[n - 1]);
+}
+
+void closeSource(SourceBuffer *sb)
+{
+  if (sb->text == NULL)
+    return;
+  free(sb->newlines);
+  if (sb->mapped)
+    munmap(sb->text, sb->size);
+  else
+    free(sb->text);
+  memset(sb, 0, sizeof(SourceBuffer));
+}
@@ -0,0 +1,38 @@
+/****************************************************/
+/* File: source.h                                   */
+/* Source input layer: the whole source file is     */
+/* mapped (or read with one syscall) into memory    */
+/****************************************************/
+
+#ifndef _SOURCE_H_
+#define _SOURCE_H_
+
+/* Function openSource maps the file at path into
+ * sb. Returns FALSE if the file cannot be read.
+ */
+int openSource(SourceBuffer *sb, const char *path);
+
+/* Function sourceFromBytes copies the len bytes
+ * at bytes into sb. Returns FALSE if out of memory.
+ */
+int sourceFromBytes(SourceBuffer *sb, const char *bytes, size_t len);
+
+/* Function lineOf returns the 1-based line of the
+ * byte at offset in sb. The newline index is built
+ * on first use and extended as far as offset only:
+ * flex keeps a NUL after its current token, so the
+ * bytes past the token being scanned are not read.
+ */
+int lineOf(SourceBuffer *sb, size_t offset);
+
+/* Function columnOf returns the 1-based column of
+ * the byte at offset in sb
+ */
+int columnOf(SourceBuffer *sb, size_t offset);
+
+/* Procedure closeSource releases the memory
+ * held by sb
+ */
+void closeSource(SourceBuffer *sb);
+
+#endif
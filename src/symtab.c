@@ -1,34 +1,26 @@
 /****************************************************/
 /* File: symtab.c                                   */
 /* Symbol table implementation for the TINY compiler*/
-/* (allows only one symbol table)                   */
+/* (one symbol table per compiler context)         */
 /* Symbol table is implemented as a chained         */
 /* hash table                                       */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
+#include "globals.h"
+#include "outbuf.h"
 #include "symtab.h"
+#include "memstat.h"
+#include "intern.h"
 
 /* SIZE is the size of the hash table */
 #define SIZE 211
 
-/* SHIFT is the power of two used as multiplier
-   in hash function  */
-#define SHIFT 4
-
-/* the hash function */
-static int hash ( char * key )
-{ int temp = 0;
-  int i = 0;
-  while (key[i] != '\0')
-  { temp = ((temp << SHIFT) + key[i]) % SIZE;
-    ++i;
-  }
-  return temp;
+/* the hash function: names are interned, so
+   their ids are already distinct small numbers */
+static int hash ( const char * key )
+{ return nameId(key) % SIZE;
 }
 
 /* the list of line numbers of the source 
@@ -46,29 +38,34 @@ typedef struct LineListRec
  * it appears in the source code
  */
 typedef struct BucketListRec
-   { char * name;
+   { const char * name;
      LineList lines;
      int memloc ; /* memory location for variable */
      struct BucketListRec * next;
    } * BucketList;
 
-/* the hash table */
-static BucketList hashTable[SIZE];
+/* the hash table of ctx, allocated on first use */
+static BucketList * table( CompilerContext * ctx )
+{ if (ctx->symtab == NULL)
+    ctx->symtab = calloc(SIZE,sizeof(BucketList));
+  return (BucketList *) ctx->symtab;
+}
 
 /* Procedure st_insert inserts line numbers and
  * memory locations into the symbol table
  * loc = memory location is inserted only the
  * first time, otherwise ignored
  */
-void st_insert( char * name, int lineno, int loc )
-{ int h = hash(name);
+void st_insert( CompilerContext * ctx, const char * name, int lineno, int loc )
+{ BucketList * hashTable = table(ctx);
+  int h = hash(name);
   BucketList l =  hashTable[h];
-  while ((l != NULL) && (strcmp(name,l->name) != 0))
+  while ((l != NULL) && (name != l->name))
     l = l->next;
   if (l == NULL) /* variable not yet in table */
-  { l = (BucketList) malloc(sizeof(struct BucketListRec));
+  { l = (BucketList) countedAlloc(ctx,sizeof(struct BucketListRec),SiteSymbol,0);
     l->name = name;
-    l->lines = (LineList) malloc(sizeof(struct LineListRec));
+    l->lines = (LineList) countedAlloc(ctx,sizeof(struct LineListRec),SiteLine,0);
     l->lines->lineno = lineno;
     l->memloc = loc;
     l->lines->next = NULL;
@@ -77,7 +74,7 @@ void st_insert( char * name, int lineno, int loc )
   else /* found in table, so just add line number */
   { LineList t = l->lines;
     while (t->next != NULL) t = t->next;
-    t->next = (LineList) malloc(sizeof(struct LineListRec));
+    t->next = (LineList) countedAlloc(ctx,sizeof(struct LineListRec),SiteLine,0);
     t->next->lineno = lineno;
     t->next->next = NULL;
   }
@@ -86,10 +83,11 @@ void st_insert( char * name, int lineno, int loc )
 /* Function st_lookup returns the memory 
  * location of a variable or -1 if not found
  */
-int st_lookup ( char * name )
-{ int h = hash(name);
+int st_lookup ( CompilerContext * ctx, const char * name )
+{ BucketList * hashTable = table(ctx);
+  int h = hash(name);
   BucketList l =  hashTable[h];
-  while ((l != NULL) && (strcmp(name,l->name) != 0))
+  while ((l != NULL) && (name != l->name))
     l = l->next;
   if (l == NULL) return -1;
   else return l->memloc;
@@ -99,24 +97,51 @@ int st_lookup ( char * name )
  * listing of the symbol table contents 
  * to the listing file
  */
-void printSymTab(FILE * listing)
-{ int i;
-  fprintf(listing,"Variable Name  Location   Line Numbers\n");
-  fprintf(listing,"-------------  --------   ------------\n");
+void printSymTab(CompilerContext * ctx)
+{ BucketList * hashTable = table(ctx);
+  OutBuf * listing = ctx->listing;
+  int i;
+  outPrintf(listing,"Variable Name  Location   Line Numbers\n");
+  outPrintf(listing,"-------------  --------   ------------\n");
   for (i=0;i<SIZE;++i)
   { if (hashTable[i] != NULL)
     { BucketList l = hashTable[i];
       while (l != NULL)
       { LineList t = l->lines;
-        fprintf(listing,"%-14s ",l->name);
-        fprintf(listing,"%-8d  ",l->memloc);
+        outPrintf(listing,"%-14s ",l->name);
+        outPrintf(listing,"%-8d  ",l->memloc);
         while (t != NULL)
-        { fprintf(listing,"%4d ",t->lineno);
+        { outPrintf(listing,"%4d ",t->lineno);
           t = t->next;
         }
-        fprintf(listing,"\n");
+        outPrintf(listing,"\n");
         l = l->next;
       }
     }
   }
 } /* printSymTab */
+
+/* Procedure st_free releases the symbol
+ * table of ctx
+ */
+void st_free( CompilerContext * ctx )
+{ BucketList * hashTable = ctx->symtab;
+  int i;
+  if (hashTable == NULL) return;
+  for (i=0;i<SIZE;++i)
+  { BucketList l = hashTable[i];
+    while (l != NULL)
+    { BucketList next = l->next;
+      LineList t = l->lines;
+      while (t != NULL)
+      { LineList tn = t->next;
+        free(t);
+        t = tn;
+      }
+      free(l);
+      l = next;
+    }
+  }
+  free(hashTable);
+  ctx->symtab = NULL;
+} /* st_free */
@@ -1,7 +1,7 @@
 /****************************************************/
 /* File: symtab.h                                   */
 /* Symbol table interface for the TINY compiler     */
-/* (allows only one symbol table)                   */
+/* (one symbol table per compiler context)         */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
@@ -9,22 +9,31 @@
 #ifndef _SYMTAB_H_
 #define _SYMTAB_H_
 
+/* Names are interned (intern.h): they are hashed
+ * by id and compared by pointer
+ */
+
 /* Procedure st_insert inserts line numbers and
  * memory locations into the symbol table
  * loc = memory location is inserted only the
  * first time, otherwise ignored
  */
-void st_insert( char * name, int lineno, int loc );
+void st_insert( CompilerContext * ctx, const char * name, int lineno, int loc );
 
 /* Function st_lookup returns the memory 
  * location of a variable or -1 if not found
  */
-int st_lookup ( char * name );
+int st_lookup ( CompilerContext * ctx, const char * name );
 
 /* Procedure printSymTab prints a formatted 
  * listing of the symbol table contents 
  * to the listing file
  */
-void printSymTab(FILE * listing);
+void printSymTab(CompilerContext * ctx);
+
+/* Procedure st_free releases the symbol
+ * table of ctx
+ */
+void st_free( CompilerContext * ctx );
 
 #endif
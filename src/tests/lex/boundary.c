@@ -0,0 +1,38 @@
+int
+a
+;
+int b[
+10
+]
+;
+int f(int x, int y[])
+{
+if (x
+<=
+y[0])
+return x
+==
+y[1];
+else
+return x
+!=
+y[2]
+;
+}
+int g(void)
+{
+int i; i =
+f(1,
+  2)
+  ;
+while (i >
+= 0) i = i
+- 1;
+return i <
+= 3 / 4
+/ 5;
+}
+int longidentifiername0123456789; int 123abc; int
+abc123
+;
+void main(void){int i;i=g();i=i*i/i+i-i;if(i!=i)i=0;else i=1;}
@@ -0,0 +1,39 @@
+/* comments that cross chunk boundaries: lexcheck
+   splits this file at every line it can */
+int x; /* one line */ int y;
+/**/ int z; /***/ int w; /****/
+/* a comment
+ * over
+ * several
+ * lines, with stars ** and slashes // and / * apart
+ */
+int a[10];
+/* "/*" does not nest: this ends here */ int b;
+/*/ still in the comment /*/
+int f(int p)
+{ /* stars before the end ***/
+  return p / 2 /* a division, then a comment */ / 3;
+}
+/*
+*/
+int g(void) { return 1/*glued*/+/**/2; }
+/* lines that end in a star *
+   or a slash /
+   or both * /
+*/
+int h(void)
+{
+  int i;
+  i = 0;
+  while (i < 10) /* loop
+                    */ i = i + 1;
+  /* * / */ return i;
+}
+/*******************************
+ * a banner
+ *******************************/
+void main(void)
+{
+  x = 1 / 2 * 3 / /* mid-expression
+  */ 4;
+}
@@ -0,0 +1,48 @@
+int x;
+/* a comment
+   with CRLF lines */
+int f(void)
+{
+  return 1 /
+  2;
+}
+int v1; /* 1
+ */
+int v2; /* 2
+ */
+int v3; /* 3
+ */
+int v4; /* 4
+ */
+int v5; /* 5
+ */
+int v6; /* 6
+ */
+int v7; /* 7
+ */
+int v8; /* 8
+ */
+int v9; /* 9
+ */
+int v10; /* 10
+ */
+int v11; /* 11
+ */
+int v12; /* 12
+ */
+int v13; /* 13
+ */
+int v14; /* 14
+ */
+int v15; /* 15
+ */
+int v16; /* 16
+ */
+int v17; /* 17
+ */
+int v18; /* 18
+ */
+int v19; /* 19
+ */
+int v20; /* 20
+ */
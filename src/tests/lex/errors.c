@@ -0,0 +1,10 @@
+int x;
+int y! z;
+@ $ # ~
+int a = 1 != 2 ! 3;
+int b; ` ' "
+/* an error inside a comment: ! @ */ int c;
+!
+!=
+!!=
+int d;
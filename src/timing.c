@@ -0,0 +1,234 @@
+/****************************************************/
+/* File: timing.c                                   */
+/* Per-phase wall/CPU timing and Chrome trace-event */
+/* spans                                            */
+/****************************************************/
+
+#include "globals.h"
+#include "timing.h"
+#include "memstat.h"
+#include <time.h>
+
+static const char *phaseNames[NPHASES] = {
+    "scan", "parse", "printTree", "analyze", "codeGen"};
+
+/* wall clock at the first timingInit; spans start there */
+static double origin = -1;
+
+double wallClock(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double cpuClock(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void timingInit(Timing *t, int tid, int spans)
+{
+  memset(t, 0, sizeof(Timing));
+  t->tid = tid;
+  t->spans = spans;
+  if (origin < 0)
+    origin = wallClock();
+}
+
+void timingFree(Timing *t)
+{
+  int i;
+  for (i = 0; i < t->nspan; i++)
+    free(t->span[i].arg);
+  free(t->span);
+  t->span = NULL;
+  t->nspan = t->maxspan = 0;
+}
+
+void spanBegin(CompilerContext *ctx, const char *name)
+{
+  Timing *t = ctx->timing;
+  if (t == NULL)
+    return;
+  if (t->depth < MAXSPANDEPTH)
+  {
+    t->openName[t->depth] = name;
+    t->openWall[t->depth] = wallClock();
+    t->openCpu[t->depth] = cpuClock();
+  }
+  t->depth++;
+}
+
+/* close the innermost span; returns its wall and CPU time */
+static void closeSpan(Timing *t, const char *arg, double *wall, double *cpu)
+{
+  double now = wallClock();
+  int d = --t->depth;
+
+  *wall = *cpu = 0;
+  if (d < 0 || d >= MAXSPANDEPTH)
+  {
+    if (d < 0)
+      t->depth = 0;
+    return;
+  }
+  *wall = now - t->openWall[d];
+  *cpu = cpuClock() - t->openCpu[d];
+  if (!t->spans)
+    return;
+  if (t->nspan == t->maxspan)
+  {
+    TimingSpan *s;
+    int max = t->maxspan ? t->maxspan * 2 : 256;
+    s = (TimingSpan *)realloc(t->span, max * sizeof(TimingSpan));
+    if (s == NULL)
+      return;
+    t->span = s;
+    t->maxspan = max;
+  }
+  t->span[t->nspan].name = t->openName[d];
+  t->span[t->nspan].arg = arg ? strdup(arg) : NULL;
+  t->span[t->nspan].start = (t->openWall[d] - origin) * 1e6;
+  t->span[t->nspan].dur = *wall * 1e6;
+  t->nspan++;
+}
+
+void spanEnd(CompilerContext *ctx, const char *arg)
+{
+  double wall, cpu;
+  if (ctx->timing != NULL)
+    closeSpan(ctx->timing, arg, &wall, &cpu);
+}
+
+int spanDepth(CompilerContext *ctx)
+{
+  return ctx->timing ? ctx->timing->depth : 0;
+}
+
+void spanUnwind(CompilerContext *ctx, int depth)
+{
+  while (ctx->timing != NULL && ctx->timing->depth > depth)
+    spanEnd(ctx, NULL);
+}
+
+void phaseBegin(CompilerContext *ctx, Phase phase)
+{
+  if (ctx->memstat != NULL)
+    ctx->memstat->phase = phase;
+  spanBegin(ctx, phaseNames[phase]);
+}
+
+void phaseEnd(CompilerContext *ctx, Phase phase)
+{
+  double wall, cpu;
+  Timing *t = ctx->timing;
+  if (ctx->memstat != NULL)
+    ctx->memstat->phase = NPHASES;
+  if (t == NULL)
+    return;
+  closeSpan(t, NULL, &wall, &cpu);
+  t->wall[phase] += wall;
+  t->cpu[phase] += cpu;
+}
+
+void printTimeReport(FILE *out, Timing *t, int n)
+{
+  double wall[NPHASES], cpu[NPHASES], totalWall = 0, totalCpu = 0;
+  double scanThread = 0, lexWall = 0, lexCpu = 0;
+  int i, p;
+
+  memset(wall, 0, sizeof(wall));
+  memset(cpu, 0, sizeof(cpu));
+  for (i = 0; i < n; i++)
+  {
+    for (p = 0; p < NPHASES; p++)
+    {
+      wall[p] += t[i].wall[p];
+      cpu[p] += t[i].cpu[p];
+    }
+    scanThread += t[i].scanThread;
+    lexWall += t[i].lexWall;
+    lexCpu += t[i].lexCpu;
+  }
+  /* getToken runs inside parse(): report parse without it;
+   * the batches are timed apart from the phase, so clock
+   * granularity must not make it negative. Lexing up front
+   * ran before parse() and is only added to scan.
+   */
+  wall[PhaseParse] = wall[PhaseParse] > wall[PhaseScan] ? wall[PhaseParse] - wall[PhaseScan] : 0;
+  cpu[PhaseParse] = cpu[PhaseParse] > cpu[PhaseScan] ? cpu[PhaseParse] - cpu[PhaseScan] : 0;
+  wall[PhaseScan] += lexWall;
+  cpu[PhaseScan] += lexCpu;
+
+  fprintf(out, "%-12s%12s%12s\n", "phase", "wall ms", "cpu ms");
+  for (p = 0; p < NPHASES; p++)
+  {
+    fprintf(out, "%-12s%12.3f%12.3f\n", phaseNames[p], wall[p] * 1e3, cpu[p] * 1e3);
+    totalWall += wall[p];
+    totalCpu += cpu[p];
+  }
+  fprintf(out, "%-12s%12.3f%12.3f\n", "total", totalWall * 1e3, totalCpu * 1e3);
+  if (scanThread > 0)
+  {
+    /* with --pipeline the scan row is the parser's
+     * wait for tokens; the rest of the scanner
+     * thread's time overlapped with parsing
+     */
+    double hidden = scanThread > wall[PhaseScan] ? scanThread - wall[PhaseScan] : 0;
+    fprintf(out, "scanner thread %.3f ms, %.3f ms (%.1f%%) hidden behind parse\n",
+            scanThread * 1e3, hidden * 1e3, 100 * hidden / scanThread);
+  }
+}
+
+/* write s as a JSON string */
+static void jsonString(FILE *f, const char *s)
+{
+  putc('"', f);
+  for (; *s; s++)
+  {
+    if (*s == '"' || *s == '\\')
+      fprintf(f, "\\%c", *s);
+    else if ((unsigned char)*s < 0x20)
+      fprintf(f, "\\u%04x", *s);
+    else
+      putc(*s, f);
+  }
+  putc('"', f);
+}
+
+int writeTrace(const char *path, Timing *t, int n)
+{
+  FILE *f = fopen(path, "w");
+  int i, j, first = TRUE;
+
+  if (f == NULL)
+    return FALSE;
+  fprintf(f, "{\"traceEvents\":[\n");
+  for (i = 0; i < n; i++)
+  {
+    fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+               "\"args\":{\"name\":\"worker %d\"}}",
+            first ? "" : ",\n", t[i].tid, t[i].tid);
+    first = FALSE;
+    for (j = 0; j < t[i].nspan; j++)
+    {
+      TimingSpan *s = &t[i].span[j];
+      fprintf(f, ",\n{\"name\":");
+      jsonString(f, s->name);
+      fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+              t[i].tid, s->start, s->dur);
+      if (s->arg != NULL)
+      {
+        fprintf(f, ",\"args\":{\"name\":");
+        jsonString(f, s->arg);
+        fprintf(f, "}");
+      }
+      fprintf(f, "}");
+    }
+  }
+  fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  return fclose(f) == 0;
+}
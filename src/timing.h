@@ -0,0 +1,111 @@
+/****************************************************/
+/* File: timing.h                                   */
+/* Per-phase wall/CPU timing (--time-report) and    */
+/* Chrome trace-event spans (--trace-out)           */
+/****************************************************/
+
+#ifndef _TIMING_H_
+#define _TIMING_H_
+
+/* compiler phases with separate time totals */
+typedef enum
+{
+   PhaseScan,    /* getToken, measured inside PhaseParse */
+   PhaseParse,
+   PhasePrint,   /* printTree */
+   PhaseAnalyze, /* buildSymtab and typeCheck */
+   PhaseCode,    /* codeGen */
+   NPHASES
+} Phase;
+
+/* MAXSPANDEPTH is the maximum nesting of open spans */
+#define MAXSPANDEPTH 32
+
+/* a finished span: a Chrome "X" (complete) event */
+typedef struct
+{
+   const char *name;
+   char *arg;       /* detail shown with the span, or NULL */
+   double start;    /* microseconds since the start of the run */
+   double dur;      /* microseconds */
+} TimingSpan;
+
+/* The timing record of one thread. A context
+ * points to it through ctx->timing; every phase
+ * and span of the context is added to it.
+ */
+typedef struct timing
+{
+   int tid;               /* thread id in the trace */
+   int spans;             /* TRUE to record spans (--trace-out) */
+   double wall[NPHASES];  /* seconds per phase */
+   double cpu[NPHASES];   /* thread CPU seconds per phase */
+   double scanThread;     /* seconds scanning on --pipeline threads;
+                             wall[PhaseScan] is then the wait for them */
+   double lexWall;        /* seconds lexing up front (--lex-threads),
+                             before PhaseParse: not part of it */
+   double lexCpu;
+
+   /* open spans */
+   int depth;
+   const char *openName[MAXSPANDEPTH];
+   double openWall[MAXSPANDEPTH];
+   double openCpu[MAXSPANDEPTH];
+
+   /* finished spans */
+   TimingSpan *span;
+   int nspan, maxspan;
+} Timing;
+
+/* Procedure timingInit prepares t for thread tid,
+ * recording spans only if spans is TRUE
+ */
+void timingInit(Timing *t, int tid, int spans);
+
+/* Procedure timingFree releases the spans of t */
+void timingFree(Timing *t);
+
+/* Function wallClock and cpuClock return the
+ * monotonic time and the CPU time of the calling
+ * thread in seconds
+ */
+double wallClock(void);
+double cpuClock(void);
+
+/* Procedure spanBegin opens a span named name on
+ * ctx->timing; name must be a string constant
+ */
+void spanBegin(CompilerContext *ctx, const char *name);
+
+/* Procedure spanEnd closes the innermost span,
+ * attaching arg (may be NULL) as its detail
+ */
+void spanEnd(CompilerContext *ctx, const char *arg);
+
+/* Function spanDepth returns the number of open
+ * spans of ctx; spanUnwind closes those opened
+ * since it returned depth, e.g. after a longjmp
+ */
+int spanDepth(CompilerContext *ctx);
+void spanUnwind(CompilerContext *ctx, int depth);
+
+/* Procedures phaseBegin and phaseEnd bracket a
+ * phase: it becomes a span, its time is added to
+ * the phase totals and its allocations are counted
+ * under it in ctx->memstat
+ */
+void phaseBegin(CompilerContext *ctx, Phase phase);
+void phaseEnd(CompilerContext *ctx, Phase phase);
+
+/* Procedure printTimeReport prints the phase totals
+ * of the n records in t
+ */
+void printTimeReport(FILE *out, Timing *t, int n);
+
+/* Function writeTrace writes the spans of the n
+ * records in t to the file path as Chrome trace
+ * JSON. Returns FALSE if path cannot be written.
+ */
+int writeTrace(const char *path, Timing *t, int n);
+
+#endif
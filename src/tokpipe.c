@@ -0,0 +1,141 @@
+/****************************************************/
+/* File: tokpipe.c                                  */
+/* Pipelined scanning (--pipeline): a scanner       */
+/* thread fills a ring of tokens that getToken()    */
+/* hands to the parser                              */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "timing.h"
+#include "tokpipe.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+/* RINGSIZE is the number of tokens in the ring;
+ * it must be a power of two
+ */
+#define RINGSIZE 4096
+
+/* polls of an empty or full ring before yielding */
+#define SPINS 64
+
+/* The ring has one producer, the scanner thread,
+ * and one consumer, the parser. head and tail only
+ * grow; each is written by one side and kept on a
+ * cache line of its own.
+ */
+typedef struct tokenPipe
+{
+  TokenSpan ring[RINGSIZE];
+  atomic_size_t head; /* tokens put in the ring */
+  char pad1[64];
+  atomic_size_t tail; /* tokens taken out of the ring */
+  char pad2[64];
+  atomic_int stop;    /* the parser is done: stop scanning */
+  int ended;          /* the parser has taken ENDFILE */
+
+  CompilerContext scan; /* the scanner thread's context */
+  pthread_t thread;
+  double scanWall;      /* seconds of scanning, less waits for room */
+} TokenPipe;
+
+static void *scanThread(void *arg)
+{
+  TokenPipe *p = (TokenPipe *)arg;
+  size_t head = 0, tail = 0;
+  double start = wallClock(), waited = 0;
+  TokenType token;
+
+  do
+  {
+    token = rawToken(&p->scan);
+    if (head - tail == RINGSIZE)
+    {
+      double wait = wallClock();
+      int spins = 0;
+      while ((tail = atomic_load_explicit(&p->tail, memory_order_acquire)) + RINGSIZE == head)
+      {
+        if (atomic_load_explicit(&p->stop, memory_order_relaxed))
+          break;
+        if (++spins > SPINS)
+          sched_yield();
+      }
+      waited += wallClock() - wait;
+      if (head - tail == RINGSIZE)
+        break; /* stopped */
+    }
+    p->ring[head & (RINGSIZE - 1)] = p->scan.tok;
+    atomic_store_explicit(&p->head, ++head, memory_order_release);
+  } while (token != ENDFILE && !atomic_load_explicit(&p->stop, memory_order_relaxed));
+  p->scanWall = wallClock() - start - waited;
+  return NULL;
+}
+
+int pipeStart(CompilerContext *ctx)
+{
+  TokenPipe *p = (TokenPipe *)malloc(sizeof(TokenPipe));
+  if (p == NULL)
+    return FALSE;
+  atomic_init(&p->head, 0);
+  atomic_init(&p->tail, 0);
+  atomic_init(&p->stop, FALSE);
+  p->ended = FALSE;
+  p->scanWall = 0;
+
+  /* the thread scans with ctx's engine, and borrows
+   * ctx's flex scanner until pipeStop
+   */
+  initContext(&p->scan);
+  p->scan.source = ctx->source;
+  p->scan.scanEngine = ctx->scanEngine;
+  p->scan.scanner = ctx->scanner;
+  scanInit(&p->scan);
+  if (pthread_create(&p->thread, NULL, scanThread, p) != 0)
+  {
+    scanRelease(&p->scan);
+    ctx->scanner = p->scan.scanner;
+    free(p);
+    return FALSE;
+  }
+  ctx->scanner = NULL;
+  ctx->pipe = p;
+  return TRUE;
+}
+
+TokenType pipeToken(CompilerContext *ctx)
+{
+  TokenPipe *p = ctx->pipe;
+  size_t tail = atomic_load_explicit(&p->tail, memory_order_relaxed);
+
+  if (p->ended)
+    return ENDFILE;
+  for (;;)
+  {
+    int spins = 0;
+    while (atomic_load_explicit(&p->head, memory_order_acquire) == tail)
+      if (++spins > SPINS)
+        sched_yield();
+    ctx->tok = p->ring[tail & (RINGSIZE - 1)];
+    atomic_store_explicit(&p->tail, ++tail, memory_order_release);
+    if (ctx->tok.kind != COMMENT || !ctx->skipComments)
+      break;
+  }
+  p->ended = ctx->tok.kind == ENDFILE;
+  return ctx->tok.kind;
+}
+
+void pipeStop(CompilerContext *ctx)
+{
+  TokenPipe *p = ctx->pipe;
+  atomic_store_explicit(&p->stop, TRUE, memory_order_relaxed);
+  pthread_join(p->thread, NULL);
+  scanRelease(&p->scan);
+  ctx->scanner = p->scan.scanner;
+  if (ctx->timing != NULL)
+    ctx->timing->scanThread += p->scanWall;
+  free(p);
+  ctx->pipe = NULL;
+}
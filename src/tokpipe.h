@@ -0,0 +1,30 @@
+/****************************************************/
+/* File: tokpipe.h                                  */
+/* Pipelined scanning (--pipeline): a scanner       */
+/* thread fills a ring of tokens that getToken()    */
+/* hands to the parser                              */
+/****************************************************/
+
+#ifndef _TOKPIPE_H_
+#define _TOKPIPE_H_
+
+/* Function pipeStart starts a scanner thread on
+ * ctx->source and sets ctx->pipe. Returns FALSE
+ * (and leaves ctx->pipe NULL) if the thread cannot
+ * be started.
+ */
+int pipeStart(CompilerContext *ctx);
+
+/* Function pipeToken waits for the next token of
+ * the scanner thread and leaves it in ctx->tok.
+ * COMMENT tokens are dropped if ctx->skipComments.
+ */
+TokenType pipeToken(CompilerContext *ctx);
+
+/* Procedure pipeStop stops and joins the scanner
+ * thread, adds its scan time to ctx->timing and
+ * clears ctx->pipe
+ */
+void pipeStop(CompilerContext *ctx);
+
+#endif
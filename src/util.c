@@ -8,256 +8,326 @@
 
 #include "globals.h"
 #include "util.h"
+#include "outbuf.h"
+#include "memstat.h"
+#include "source.h"
+#include "intern.h"
+#include "arena.h"
+#include "share.h"
+#include "scan.h"
+
+/* Procedure initContext resets ctx to the state
+ * of a fresh compilation with the default
+ * tracing flags
+ */
+void initContext(CompilerContext *ctx)
+{
+  memset(ctx, 0, sizeof(CompilerContext));
+
+  /* set tracing flags */
+  ctx->EchoSource = FALSE;
+  ctx->TraceScan = FALSE;
+  ctx->TraceParse = TRUE;
+  ctx->TraceAnalyze = FALSE;
+  ctx->TraceCode = FALSE;
+
+  ctx->Error = FALSE;
+  ctx->maxErrors = 1;
+}
+
+/* Procedure resetContext prepares ctx for its
+ * next compilation. The tracing flags and the
+ * scanner are kept, so that a long-lived context
+ * does not pay for them again
+ */
+void resetContext(CompilerContext *ctx)
+{
+  ctx->source = NULL;
+  ctx->listing = NULL;
+  ctx->code = NULL;
+  ctx->Error = FALSE;
+  ctx->tokenString[0] = '\0';
+  memset(&ctx->tok, 0, sizeof(TokenSpan));
+  ctx->skipComments = FALSE;
+  ctx->token = ENDFILE;
+  ctx->indentno = 0;
+  ctx->location = 0;
+  ctx->emitLoc = 0;
+  ctx->highEmitLoc = 0;
+  ctx->tmpOffset = 0;
+  internReset(ctx);
+  shareReset(ctx);
+  arenaReset(ctx); /* the last compilation's tree */
+}
+
+void freeContext(CompilerContext *ctx)
+{
+  scanDone(ctx);
+  internFree(ctx);
+  shareFree(ctx);
+  arenaFree(ctx);
+}
+
+/* print name padded to 20 columns, sep and the lexeme */
+static void tokenLine(OutBuf *out, const char *name, const char *sep,
+                      const char *lexeme)
+{
+  outPad(out, name, 20);
+  outPuts(out, sep);
+  outPuts(out, lexeme);
+  outChar(out, '\n');
+}
 
 /* Procedure printToken prints a token
- * and its lexeme to the listing file
+ * and its lexeme to the ctx->listing file
  */
-void printToken(TokenType token, const char *tokenString)
+void printToken(CompilerContext *ctx, TokenType token, const char *tokenString)
 {
-  if (TraceScan)
+  if (ctx->TraceScan)
   {
     /* comment는 skip */
     if (token == COMMENT)
       return;
 
     /* line number */
-    fprintf(listing, "%-10d%10s", lineno, "");
+    outIntPad(ctx->listing, currentLine(ctx), 10);
+    outIndent(ctx->listing, 10);
     switch (token)
     {
 
     /* error handling */
     case ERROR:
-      fprintf(listing, "%-20s%s\n", "ERROR", tokenString);
+      tokenLine(ctx->listing, "ERROR", "", tokenString);
       break;
     case COMMENT_ERROR:
-      fprintf(listing, "%-20s%s\n", "ERROR", "Comment Error");
+      tokenLine(ctx->listing, "ERROR", "", "Comment Error");
       break;
     case ENDFILE:
-      fprintf(listing, "%-20s\n", "EOF");
+      tokenLine(ctx->listing, "EOF", "", "");
       break;
 
     /* 나머지 token들은 그대로 출력 */
     /* reserved words */
     case IF:
-      fprintf(listing, "%-20s\t%s\n", "IF", tokenString);
+      tokenLine(ctx->listing, "IF", "\t", tokenString);
       break;
     case ELSE:
-      fprintf(listing, "%-20s\t%s\n", "ELSE", tokenString);
+      tokenLine(ctx->listing, "ELSE", "\t", tokenString);
       break;
     case INT:
-      fprintf(listing, "%-20s%s\n", "INT", tokenString);
+      tokenLine(ctx->listing, "INT", "", tokenString);
       break;
     case RETURN:
-      fprintf(listing, "%-20s\t%s\n", "RETURN", tokenString);
+      tokenLine(ctx->listing, "RETURN", "\t", tokenString);
       break;
     case VOID:
-      fprintf(listing, "%-20s\t%s\n", "VOID", tokenString);
+      tokenLine(ctx->listing, "VOID", "\t", tokenString);
       break;
     case WHILE:
-      fprintf(listing, "%-20s\t%s\n", "WHILE", tokenString);
+      tokenLine(ctx->listing, "WHILE", "\t", tokenString);
       break;
 
     /* multicharacter tokens */
     case ID:
-      fprintf(listing, "%-20s%s\n", "ID", tokenString);
+      tokenLine(ctx->listing, "ID", "", tokenString);
       break;
     case NUM:
-      fprintf(listing, "%-20s%s\n", "NUM", tokenString);
+      tokenLine(ctx->listing, "NUM", "", tokenString);
       break;
 
     /* special symbols */
     case ASSIGN:
-      fprintf(listing, "%-20s%s\n", "=", tokenString);
+      tokenLine(ctx->listing, "=", "", tokenString);
       break;
     case SEMI:
-      fprintf(listing, "%-20s%s\n", ";", tokenString);
+      tokenLine(ctx->listing, ";", "", tokenString);
       break;
     case COMMA:
-      fprintf(listing, "%-20s%s\n", ",", tokenString);
+      tokenLine(ctx->listing, ",", "", tokenString);
       break;
 
     case LT:
-      fprintf(listing, "%-20s%s\n", "<", tokenString);
+      tokenLine(ctx->listing, "<", "", tokenString);
       break;
     case LTEQ:
-      fprintf(listing, "%-20s%s\n", "<=", tokenString);
+      tokenLine(ctx->listing, "<=", "", tokenString);
       break;
     case GT:
-      fprintf(listing, "%-20s%s\n", ">", tokenString);
+      tokenLine(ctx->listing, ">", "", tokenString);
       break;
     case GTEQ:
-      fprintf(listing, "%-20s%s\n", ">=", tokenString);
+      tokenLine(ctx->listing, ">=", "", tokenString);
       break;
     case EQ:
-      fprintf(listing, "%-20s%s\n", "==", tokenString);
+      tokenLine(ctx->listing, "==", "", tokenString);
       break;
     case NOTEQ:
-      fprintf(listing, "%-20s%s\n", "!=", tokenString);
+      tokenLine(ctx->listing, "!=", "", tokenString);
       break;
 
     case PLUS:
-      fprintf(listing, "%-20s%s\n", "+", tokenString);
+      tokenLine(ctx->listing, "+", "", tokenString);
       break;
     case MINUS:
-      fprintf(listing, "%-20s%s\n", "-", tokenString);
+      tokenLine(ctx->listing, "-", "", tokenString);
       break;
     case TIMES:
-      fprintf(listing, "%-20s%s\n", "*", tokenString);
+      tokenLine(ctx->listing, "*", "", tokenString);
       break;
     case OVER:
-      fprintf(listing, "%-20s%s\n", "/", tokenString);
+      tokenLine(ctx->listing, "/", "", tokenString);
       break;
 
     case LPAREN:
-      fprintf(listing, "%-20s%s\n", "(", tokenString);
+      tokenLine(ctx->listing, "(", "", tokenString);
       break;
     case RPAREN:
-      fprintf(listing, "%-20s%s\n", ")", tokenString);
+      tokenLine(ctx->listing, ")", "", tokenString);
       break;
     case LBRACE:
-      fprintf(listing, "%-20s%s\n", "{", tokenString);
+      tokenLine(ctx->listing, "{", "", tokenString);
       break;
     case RBRACE:
-      fprintf(listing, "%-20s%s\n", "}", tokenString);
+      tokenLine(ctx->listing, "}", "", tokenString);
       break;
     case LBRACKET:
-      fprintf(listing, "%-20s%s\n", "[", tokenString);
+      tokenLine(ctx->listing, "[", "", tokenString);
       break;
     case RBRACKET:
-      fprintf(listing, "%-20s%s\n", "]", tokenString);
+      tokenLine(ctx->listing, "]", "", tokenString);
       break;
 
     default: /* should never happen */
-      fprintf(listing, "Unknown token: %d\n", token);
+      outPrintf(ctx->listing, "Unknown token: %d\n", token);
     }
   }
-  if (TraceParse)
+  if (ctx->TraceParse)
   {
     switch (token)
     {
       // TODO
     /* error handling */
     case ERROR:
-      fprintf(listing, "%s, %s\n", "ERROR", tokenString);
+      outPrintf(ctx->listing, "%s, %s\n", "ERROR", tokenString);
       break;
     case COMMENT_ERROR:
-      fprintf(listing, "%s, %s\n", "ERROR", "Comment Error");
+      outPrintf(ctx->listing, "%s, %s\n", "ERROR", "Comment Error");
       break;
     case ENDFILE:
-      fprintf(listing, "%s\n", "EOF");
+      outPuts(ctx->listing, "EOF\n");
       break;
 
     /* 나머지 token들은 그대로 출력 */
     /* reserved words */
     case IF:
-      fprintf(listing, "%s", "IF");
+      outPuts(ctx->listing, "IF");
       break;
     case ELSE:
-      fprintf(listing, "%s", "ELSE");
+      outPuts(ctx->listing, "ELSE");
       break;
     case INT:
-      fprintf(listing, "%s", "INT");
+      outPuts(ctx->listing, "INT");
       break;
     case RETURN:
-      fprintf(listing, "%s", "RETURN");
+      outPuts(ctx->listing, "RETURN");
       break;
     case VOID:
-      fprintf(listing, "%s", "VOID");
+      outPuts(ctx->listing, "VOID");
       break;
     case WHILE:
-      fprintf(listing, "%s", "WHILE");
+      outPuts(ctx->listing, "WHILE");
       break;
 
     /* multicharacter tokens */
     case ID:
-      fprintf(listing, "%s", "ID");
+      outPuts(ctx->listing, "ID");
       break;
     case NUM:
-      fprintf(listing, "%s", "NUM");
+      outPuts(ctx->listing, "NUM");
       break;
 
     /* special symbols */
     case ASSIGN:
-      fprintf(listing, "%s", "=");
+      outPuts(ctx->listing, "=");
       break;
     case SEMI:
-      fprintf(listing, "%s", ";");
+      outPuts(ctx->listing, ";");
       break;
     case COMMA:
-      fprintf(listing, "%s", ",");
+      outPuts(ctx->listing, ",");
       break;
 
     case LT:
-      fprintf(listing, "%s", "<");
+      outPuts(ctx->listing, "<");
       break;
     case LTEQ:
-      fprintf(listing, "%s", "<=");
+      outPuts(ctx->listing, "<=");
       break;
     case GT:
-      fprintf(listing, "%s", ">");
+      outPuts(ctx->listing, ">");
       break;
     case GTEQ:
-      fprintf(listing, "%s", ">=");
+      outPuts(ctx->listing, ">=");
       break;
     case EQ:
-      fprintf(listing, "%s", "==");
+      outPuts(ctx->listing, "==");
       break;
     case NOTEQ:
-      fprintf(listing, "%s", "!=");
+      outPuts(ctx->listing, "!=");
       break;
 
     case PLUS:
-      fprintf(listing, "%s", "+");
+      outPuts(ctx->listing, "+");
       break;
     case MINUS:
-      fprintf(listing, "%s", "-");
+      outPuts(ctx->listing, "-");
       break;
     case TIMES:
-      fprintf(listing, "%s", "*");
+      outPuts(ctx->listing, "*");
       break;
     case OVER:
-      fprintf(listing, "%s", "/");
+      outPuts(ctx->listing, "/");
       break;
 
     case LPAREN:
-      fprintf(listing, "%s", "(");
+      outPuts(ctx->listing, "(");
       break;
     case RPAREN:
-      fprintf(listing, "%s", ")");
+      outPuts(ctx->listing, ")");
       break;
     case LBRACE:
-      fprintf(listing, "%s", "{");
+      outPuts(ctx->listing, "{");
       break;
     case RBRACE:
-      fprintf(listing, "%s", "}");
+      outPuts(ctx->listing, "}");
       break;
     case LBRACKET:
-      fprintf(listing, "%s", "[");
+      outPuts(ctx->listing, "[");
       break;
     case RBRACKET:
-      fprintf(listing, "%s", "]");
+      outPuts(ctx->listing, "]");
       break;
 
     default: /* should never happen */
-      fprintf(listing, "Unknown token: %d\n", token);
+      outPrintf(ctx->listing, "Unknown token: %d\n", token);
     }
 
     if (strlen(tokenString) > 0)
-      fprintf(listing, ", %s\n", tokenString);
+      outLine(ctx->listing, ", ", tokenString);
     else
-      fprintf(listing, "\n");
+      outPuts(ctx->listing, "\n");
   }
 }
 
 /* Function newStmtNode creates a new statement
  * node for syntax tree construction
  */
-TreeNode *newStmtNode(StmtKind kind)
+TreeNode *newStmtNode(CompilerContext *ctx, StmtKind kind)
 {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+  TreeNode *t = (TreeNode *)arenaAlloc(ctx, sizeof(TreeNode), SiteStmtNode, kind);
   int i;
   if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
+    outPrintf(ctx->listing, "Out of memory error at line %d\n", currentLine(ctx));
   else
   {
     for (i = 0; i < MAXCHILDREN; i++)
@@ -265,7 +335,7 @@ TreeNode *newStmtNode(StmtKind kind)
     t->sibling = NULL;
     t->nodekind = StmtK;
     t->kind.stmt = kind;
-    t->lineno = lineno;
+    t->offset = ctx->tok.offset;
 
     /* [HW2] Jiho Rhee */
     t->arr_size = 0;
@@ -276,12 +346,12 @@ TreeNode *newStmtNode(StmtKind kind)
 /* Function newExpNode creates a new expression
  * node for syntax tree construction
  */
-TreeNode *newExpNode(ExpKind kind)
+TreeNode *newExpNode(CompilerContext *ctx, ExpKind kind)
 {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+  TreeNode *t = (TreeNode *)arenaAlloc(ctx, sizeof(TreeNode), SiteExpNode, kind);
   int i;
   if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
+    outPrintf(ctx->listing, "Out of memory error at line %d\n", currentLine(ctx));
   else
   {
     for (i = 0; i < MAXCHILDREN; i++)
@@ -289,7 +359,7 @@ TreeNode *newExpNode(ExpKind kind)
     t->sibling = NULL;
     t->nodekind = ExpK;
     t->kind.exp = kind;
-    t->lineno = lineno;
+    t->offset = ctx->tok.offset;
     t->type = Void;
 
     /* [HW2] Jiho Rhee */
@@ -306,20 +376,26 @@ TreeNode *newExpNode(ExpKind kind)
  * Create new node for TYPE keyword.
  * This node will be a child of VarDeclK or ArrayDeclK or FuncDeclK.
  */
-TreeNode *newTypeNode(ExpType type)
+TreeNode *newTypeNode(CompilerContext *ctx, ExpType type)
 {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+  TreeNode **slot = sharedSlot(ctx, TypeK, type);
+  TreeNode *t;
   int i;
+  if (slot != NULL && *slot != NULL)
+    return *slot;
+  t = (TreeNode *)arenaAlloc(ctx, sizeof(TreeNode), SiteTypeNode, 0);
   if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
+    outPrintf(ctx->listing, "Out of memory error at line %d\n", currentLine(ctx));
   else
   {
     for (i = 0; i < MAXCHILDREN; i++)
       t->child[i] = NULL;
     t->sibling = NULL;
     t->nodekind = TypeK;
-    t->lineno = lineno;
+    t->offset = ctx->tok.offset;
     t->type = type; /* This member will be printed to parse tree. */
+    if (slot != NULL)
+      *slot = t;
   }
   return t;
 }
@@ -328,20 +404,26 @@ TreeNode *newTypeNode(ExpType type)
  * Create new node for ARRAY SIZE.
  * This node will be a child of ArrayDeclK.
  */
-TreeNode *newArrSizeNode(int size)
+TreeNode *newArrSizeNode(CompilerContext *ctx, int size)
 {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+  TreeNode **slot = sharedSlot(ctx, ArrSizeK, size);
+  TreeNode *t;
   int i;
+  if (slot != NULL && *slot != NULL)
+    return *slot;
+  t = (TreeNode *)arenaAlloc(ctx, sizeof(TreeNode), SiteArrSizeNode, 0);
   if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
+    outPrintf(ctx->listing, "Out of memory error at line %d\n", currentLine(ctx));
   else
   {
     for (i = 0; i < MAXCHILDREN; i++)
       t->child[i] = NULL;
     t->sibling = NULL;
     t->nodekind = ArrSizeK;
-    t->lineno = lineno;
+    t->offset = ctx->tok.offset;
     t->arr_size = size; /* This member will be printed to parse tree. */
+    if (slot != NULL)
+      *slot = t;
   }
   return t;
 }
@@ -350,11 +432,11 @@ TreeNode *newArrSizeNode(int size)
  * Create new node for PARAM.
  * This node will be a child of FuncDeclK, FuncCallK.
  */
-TreeNode *newParamNode(ExpType type)
+TreeNode *newParamNode(CompilerContext *ctx, ExpType type)
 {
-  TreeNode *t = newExpNode(ParamListK);
+  TreeNode *t = newExpNode(ctx, ParamListK);
   if (t != NULL && type != Void)
-    t->child[0] = newTypeNode(type);
+    t->child[0] = newTypeNode(ctx, type);
 
   return t;
 }
@@ -362,9 +444,9 @@ TreeNode *newParamNode(ExpType type)
 /**
  * Create new node for simple-expression.
  */
-TreeNode *newSimpleExpNode()
+TreeNode *newSimpleExpNode(CompilerContext *ctx)
 {
-  TreeNode *t = newExpNode(SimpleExpK);
+  TreeNode *t = newExpNode(ctx, SimpleExpK);
   if (t != NULL)
     t->attr.name = "Simple Expression";
 
@@ -374,9 +456,9 @@ TreeNode *newSimpleExpNode()
 /**
  * Create new node for additive-expression.
  */
-TreeNode *newAddExpNode()
+TreeNode *newAddExpNode(CompilerContext *ctx)
 {
-  TreeNode *t = newExpNode(AddExpK);
+  TreeNode *t = newExpNode(ctx, AddExpK);
   if (t != NULL)
     t->attr.name = "Additive Expression";
 
@@ -386,15 +468,27 @@ TreeNode *newAddExpNode()
 /**
  * Create new node for NUM.
  */
-TreeNode *newConstExpNode(int val)
+TreeNode *newConstExpNode(CompilerContext *ctx, int val)
 {
-  TreeNode *t = newExpNode(ConstK);
+  TreeNode *t = newExpNode(ctx, ConstK);
   if (t != NULL)
     t->attr.val = val;
 
   return t;
 }
 
+/**
+ * Create new node for an operator.
+ */
+TreeNode *newOpNode(CompilerContext *ctx, TokenType op)
+{
+  TreeNode *t = newExpNode(ctx, OpK);
+  if (t != NULL)
+    t->attr.op = op;
+
+  return t;
+}
+
 /**
  * Check if given op is relop.
  */
@@ -426,103 +520,142 @@ int is_mulop(TokenType token)
          token == OVER;
 }
 
-/* Function copyString allocates and makes a new
- * copy of an existing string
+/* Function copyString makes a new copy of an
+ * existing string in the tree arena (arena.h)
  */
-char *copyString(char *s)
+char *copyString(CompilerContext *ctx, char *s)
 {
   int n;
   char *t;
   if (s == NULL)
     return NULL;
   n = strlen(s) + 1;
-  t = (char *)malloc(n);
+  t = (char *)arenaAlloc(ctx, n, SiteString, 0);
   if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
+    outPrintf(ctx->listing, "Out of memory error at line %d\n", currentLine(ctx));
   else
     strcpy(t, s);
   return t;
 }
 
+/* the bytes of the current token's lexeme; the
+ * lexeme is limited to MAXTOKENLEN characters as
+ * the scanner has always done
+ */
+static const char *lexeme(CompilerContext *ctx, int *len)
+{
+  *len = ctx->tok.len < MAXTOKENLEN ? ctx->tok.len : MAXTOKENLEN;
+  return ctx->source->text + ctx->tok.offset;
+}
+
+int currentLine(CompilerContext *ctx)
+{
+  return lineOf(ctx->source, ctx->tok.offset + ctx->tok.len);
+}
+
+const char *tokenText(CompilerContext *ctx)
+{
+  int n;
+  const char *s = lexeme(ctx, &n);
+  memcpy(ctx->tokenString, s, n);
+  ctx->tokenString[n] = '\0';
+  return ctx->tokenString;
+}
+
+const char *internLexeme(CompilerContext *ctx)
+{
+  int n;
+  const char *s = lexeme(ctx, &n);
+  const char *t = internName(ctx, s, n);
+  if (t == NULL)
+    outPrintf(ctx->listing, "Out of memory error at line %d\n", currentLine(ctx));
+  return t;
+}
+
+int lexemeValue(CompilerContext *ctx)
+{
+  int n, i, val = 0;
+  const char *s = lexeme(ctx, &n);
+  for (i = 0; i < n && s[i] >= '0' && s[i] <= '9'; i++)
+    val = val * 10 + (s[i] - '0');
+  return val;
+}
+
 /**
  * Set node name.
  */
-void set_name(TreeNode *t, char *name)
+void set_name(TreeNode *t, const char *name)
 {
   if (t != NULL)
     t->attr.name = name;
 }
 
-/* Variable indentno is used by printTree to
- * store current number of spaces to indent
+/* macros to increase/decrease indentation;
+ * ctx->indentno stores the current number of
+ * spaces to indent
  */
-static int indentno = 0;
-
-/* macros to increase/decrease indentation */
-#define INDENT indentno += 2
-#define UNINDENT indentno -= 2
+#define INDENT ctx->indentno += 2
+#define UNINDENT ctx->indentno -= 2
 
 /* printSpaces indents by printing spaces */
-static void printSpaces(void)
+static void printSpaces(CompilerContext *ctx)
 {
-  int i;
-  for (i = 0; i < indentno; i++)
-    fprintf(listing, " ");
+  outIndent(ctx->listing, ctx->indentno);
 }
 
 /* procedure printTree prints a syntax tree to the
- * listing file using indentation to indicate subtrees
+ * ctx->listing file using indentation to indicate subtrees
  */
-void printTree(TreeNode *tree)
+void printTree(CompilerContext *ctx, TreeNode *tree)
 {
   int i;
   INDENT;
   while (tree != NULL)
   {
-    printSpaces();
+    printSpaces(ctx);
     if (tree->nodekind == StmtK)
     {
       switch (tree->kind.stmt)
       {
       case IfK:
-        fprintf(listing, "If\n");
+        outPuts(ctx->listing, "If\n");
         break;
       case ElseK:
-        fprintf(listing, "Else\n");
+        outPuts(ctx->listing, "Else\n");
         // case RepeatK:
-        //   fprintf(listing, "Repeat\n");
+        //   outPuts(ctx->listing, "Repeat\n");
         break;
       case AssignK:
-        fprintf(listing, "Assign : %s\n", "=");
+        outPuts(ctx->listing, "Assign : =\n");
         break;
       // case ReadK:
-      //   fprintf(listing, "Read: %s\n", tree->attr.name);
+      //   outLine(ctx->listing, "Read: ", tree->attr.name);
       //   break;
       // case WriteK:
-      //   fprintf(listing, "Write\n");
+      //   outPuts(ctx->listing, "Write\n");
       //   break;
 
       /* [HW2] Jiho Rhee */
       case CompoundK: /* COMPOUND statement */
-        fprintf(listing, "Compound Statement\n");
+        outPuts(ctx->listing, "Compound Statement\n");
         break;
       case WhileK: /* WHILE statement */
-        fprintf(listing, "While\n");
+        outPuts(ctx->listing, "While\n");
         break;
       case ReturnK: /* RETURN statement */
-        fprintf(listing, "Return\n");
+        outPuts(ctx->listing, "Return\n");
         break;
       case VarDeclK: /* Variable declaration */
-        fprintf(listing, "Variable Declare : %s\n", tree->attr.name);
+        outLine(ctx->listing, "Variable Declare : ", tree->attr.name);
         break;
       case ArrayDeclK: /* Array declaration */
-        fprintf(listing, "Array Declare : %s\n", tree->attr.name);
+        outLine(ctx->listing, "Array Declare : ", tree->attr.name);
         break;
       case FuncDeclK: /* Function declaration */
-        fprintf(listing, "Function Declare : %s\n", tree->attr.name);
+        outLine(ctx->listing, "Function Declare : ", tree->attr.name);
         break;
       default:
-        fprintf(listing, "Unknown ExpNode kind\n");
+        outPuts(ctx->listing, "Unknown ExpNode kind\n");
         break;
       }
     }
@@ -531,51 +664,53 @@ void printTree(TreeNode *tree)
       switch (tree->kind.exp)
       {
       case OpK:
-        fprintf(listing, "Op: ");
-        printToken(tree->attr.op, "\0");
+        outPuts(ctx->listing, "Op: ");
+        printToken(ctx, tree->attr.op, "\0");
         break;
       case ConstK:
-        fprintf(listing, "Const: %d\n", tree->attr.val);
+        outPuts(ctx->listing, "Const: ");
+        outInt(ctx->listing, tree->attr.val);
+        outChar(ctx->listing, '\n');
         break;
       case IdK:
-        fprintf(listing, "Id: %s\n", tree->attr.name);
+        outLine(ctx->listing, "Id: ", tree->attr.name);
         break;
 
       case VarCallK:
-        fprintf(listing, "Variable: %s\n", tree->attr.name);
+        outLine(ctx->listing, "Variable: ", tree->attr.name);
         break;
       case ArrayCallK:
-        fprintf(listing, "Array: %s\n", tree->attr.name);
+        outLine(ctx->listing, "Array: ", tree->attr.name);
         break;
       case FuncCallK:
-        fprintf(listing, "Function Call: %s\n", tree->attr.name);
+        outLine(ctx->listing, "Function Call: ", tree->attr.name);
         break;
 
       case ParamListK:
-        fprintf(listing, "Parameter(s)\n");
+        outPuts(ctx->listing, "Parameter(s)\n");
         break;
       case ParamK:
-        fprintf(listing, "Variable: %s\n", tree->attr.name);
+        outLine(ctx->listing, "Variable: ", tree->attr.name);
         break;
       case ArgK:
-        fprintf(listing, "Argument(s)\n");
+        outPuts(ctx->listing, "Argument(s)\n");
         break;
 
       case SimpleExpK:
-        fprintf(listing, "Simple Expression\n");
+        outPuts(ctx->listing, "Simple Expression\n");
         break;
       case AddExpK:
-        fprintf(listing, "Additive Expression\n");
+        outPuts(ctx->listing, "Additive Expression\n");
         break;
       case TermK:
-        fprintf(listing, "Term\n");
+        outPuts(ctx->listing, "Term\n");
         break;
 
       case ArrayIndexK:
-        fprintf(listing, "Index\n");
+        outPuts(ctx->listing, "Index\n");
         break;
       default:
-        fprintf(listing, "Unknown ExpNode kind\n");
+        outPuts(ctx->listing, "Unknown ExpNode kind\n");
         break;
       }
     }
@@ -584,26 +719,191 @@ void printTree(TreeNode *tree)
       switch (tree->type)
       {
       case Integer:
-        fprintf(listing, "Type: %s\n", "int");
+        outPuts(ctx->listing, "Type: int\n");
         break;
       case Void:
-        fprintf(listing, "Type: %s\n", "void");
+        outPuts(ctx->listing, "Type: void\n");
         break;
       case IntegerArray:
-        fprintf(listing, "Type: %s\n", "int[]");
+        outPuts(ctx->listing, "Type: int[]\n");
         break;
       default:
-        fprintf(listing, "Unknown type\n");
+        outPuts(ctx->listing, "Unknown type\n");
         break;
       }
     }
     else if (tree->nodekind == ArrSizeK)
-      fprintf(listing, "Size: %d\n", tree->arr_size);
+    {
+      outPuts(ctx->listing, "Size: ");
+      outInt(ctx->listing, tree->arr_size);
+      outChar(ctx->listing, '\n');
+    }
     else
-      fprintf(listing, "Unknown node kind\n");
+      outPuts(ctx->listing, "Unknown node kind\n");
     for (i = 0; i < MAXCHILDREN; i++)
-      printTree(tree->child[i]);
+      printTree(ctx, tree->child[i]);
     tree = tree->sibling;
   }
   UNINDENT;
 }
+
+/* the tokens of an open token file */
+typedef struct tokenFile
+{
+  SourceBuffer file;       /* the mapped token file */
+  const TokenRecord *rec;  /* its records */
+  uint64_t ntokens, next;  /* records, and the next to take */
+} TokenFile;
+
+/* hash of the source bytes a token file belongs to,
+ * eight bytes at a time
+ */
+static uint64_t sourceHash(const char *p, size_t len)
+{
+  uint64_t h = 0xcbf29ce484222325ull ^ len;
+  uint64_t w;
+  while (len >= 8)
+  {
+    memcpy(&w, p, 8);
+    h = (h ^ w) * 0x100000001b3ull;
+    h ^= h >> 29;
+    p += 8;
+    len -= 8;
+  }
+  w = 0;
+  memcpy(&w, p, len);
+  h = (h ^ w) * 0x100000001b3ull;
+  return h ^ (h >> 32);
+}
+
+int writeTokenFile(CompilerContext *ctx, const char *path)
+{
+  TokenFileHeader hdr;
+  TokenRecord rec;
+  TokenType token;
+  FILE *f;
+  int ok;
+
+  if (ctx->source->len > UINT32_MAX)
+  {
+    fprintf(stderr, "%s: source too large for a token file\n", path);
+    return FALSE;
+  }
+  f = fopen(path, "wb");
+  if (f == NULL)
+  {
+    fprintf(stderr, "fopen(%s) failed.\n", path);
+    return FALSE;
+  }
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, TOKMAGIC, 4);
+  hdr.version = TOKVERSION;
+  hdr.recordSize = sizeof(TokenRecord);
+  hdr.byteOrder = TOKBYTEORDER;
+  hdr.kindBits = TOKKINDBITS;
+  hdr.sourceLen = ctx->source->len;
+  hdr.sourceHash = sourceHash(ctx->source->text, ctx->source->len);
+
+  /* the header is written again once the count is known */
+  ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+  do
+  {
+    token = getToken(ctx);
+    if ((uint32_t)ctx->tok.len > TOKMAXLEN)
+    {
+      fprintf(stderr, "%s: token too long for a token file\n", path);
+      ok = FALSE;
+      break;
+    }
+    rec.offset = ctx->tok.offset;
+    rec.lenKind = (uint32_t)ctx->tok.len << TOKKINDBITS | token;
+    ok = ok && fwrite(&rec, sizeof(rec), 1, f) == 1;
+    hdr.ntokens++;
+  } while (token != ENDFILE);
+
+  ok = ok && fseek(f, 0, SEEK_SET) == 0 && fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+  ok = fclose(f) == 0 && ok;
+  if (!ok)
+  {
+    fprintf(stderr, "cannot write %s\n", path);
+    remove(path);
+  }
+  return ok;
+}
+
+int openTokenFile(CompilerContext *ctx, const char *path)
+{
+  TokenFile *tf = (TokenFile *)malloc(sizeof(TokenFile));
+  const TokenFileHeader *hdr;
+  size_t size;
+
+  if (tf == NULL)
+    return FALSE;
+  if (!openSource(&tf->file, path))
+  {
+    free(tf);
+    return FALSE;
+  }
+  hdr = (const TokenFileHeader *)tf->file.text;
+  size = tf->file.len;
+  /* a file of another version, machine or source is not
+   * used, nor one whose size is not that of its records
+   */
+  if (size < sizeof(TokenFileHeader) || memcmp(hdr->magic, TOKMAGIC, 4) != 0 ||
+      hdr->version != TOKVERSION || hdr->recordSize != sizeof(TokenRecord) ||
+      hdr->byteOrder != TOKBYTEORDER || hdr->kindBits != TOKKINDBITS ||
+      hdr->ntokens == 0 ||
+      (size - sizeof(TokenFileHeader)) % sizeof(TokenRecord) != 0 ||
+      hdr->ntokens != (size - sizeof(TokenFileHeader)) / sizeof(TokenRecord) ||
+      hdr->sourceLen != ctx->source->len ||
+      hdr->sourceHash != sourceHash(ctx->source->text, ctx->source->len))
+  {
+    closeSource(&tf->file);
+    free(tf);
+    return FALSE;
+  }
+  tf->rec = (const TokenRecord *)(hdr + 1);
+  tf->ntokens = hdr->ntokens;
+  tf->next = 0;
+  ctx->tokens = tf;
+  return TRUE;
+}
+
+TokenType tokenFileToken(CompilerContext *ctx)
+{
+  TokenFile *tf = ctx->tokens;
+  for (;;)
+  {
+    const TokenRecord *r = &tf->rec[tf->next];
+    uint32_t kind = r->lenKind & TOKKINDMASK, len = r->lenKind >> TOKKINDBITS;
+    /* a record that does not fit the source ends the
+     * stream, as does a last record that is not ENDFILE
+     */
+    if (kind > RBRACKET || r->offset > ctx->source->len ||
+        len > ctx->source->len - r->offset ||
+        (tf->next + 1 == tf->ntokens && kind != ENDFILE))
+    {
+      ctx->tok.kind = ENDFILE;
+      ctx->tok.offset = ctx->source->len;
+      ctx->tok.len = 0;
+      return ENDFILE;
+    }
+    ctx->tok.kind = (TokenType)kind;
+    ctx->tok.offset = r->offset;
+    ctx->tok.len = len;
+    /* the last record is ENDFILE: it is repeated */
+    if (tf->next + 1 < tf->ntokens)
+      tf->next++;
+    if (ctx->tok.kind != COMMENT || !ctx->skipComments)
+      return ctx->tok.kind;
+  }
+}
+
+void closeTokenFile(CompilerContext *ctx)
+{
+  if (ctx->tokens == NULL)
+    return;
+  closeSource(&ctx->tokens->file);
+  free(ctx->tokens);
+  ctx->tokens = NULL;
+}
@@ -8,20 +8,43 @@
 #ifndef _UTIL_H_
 #define _UTIL_H_
 
+#include <stdint.h>
+
+/* Procedure initContext resets ctx to the state
+ * of a fresh compilation with the default
+ * tracing flags
+ */
+void initContext(CompilerContext *);
+
+/* Procedure resetContext prepares ctx for its
+ * next compilation. The tracing flags and the
+ * scanner are kept, so that a long-lived context
+ * does not pay for them again; the tree of the
+ * last compilation is released, but its memory
+ * is kept for the next one
+ */
+void resetContext(CompilerContext *);
+
+/* Procedure freeContext releases what ctx keeps
+ * between compilations: the scanner, the name
+ * table and the tree arena
+ */
+void freeContext(CompilerContext *);
+
 /* Procedure printToken prints a token
  * and its lexeme to the listing file
  */
-void printToken(TokenType, const char *);
+void printToken(CompilerContext *, TokenType, const char *);
 
 /* Function newStmtNode creates a new statement
  * node for syntax tree construction
  */
-TreeNode *newStmtNode(StmtKind);
+TreeNode *newStmtNode(CompilerContext *, StmtKind);
 
 /* Function newExpNode creates a new expression
  * node for syntax tree construction
  */
-TreeNode *newExpNode(ExpKind);
+TreeNode *newExpNode(CompilerContext *, ExpKind);
 
 /**
  * [HW2] Jiho Rhee
@@ -30,35 +53,42 @@ TreeNode *newExpNode(ExpKind);
 /**
  * Create new node for TYPE keyword.
  * This node will be a child of VarDeclK or ArrayDeclK or FuncDeclK.
+ * The node is shared (share.h).
  */
-TreeNode *newTypeNode(ExpType);
+TreeNode *newTypeNode(CompilerContext *, ExpType);
 
 /**
  * Create new node for ARRAY SIZE.
  * This node will be a child of ArrayDeclK.
+ * The node is shared (share.h).
  */
-TreeNode *newArrSizeNode(int);
+TreeNode *newArrSizeNode(CompilerContext *, int);
 
 /**
  * Create new node for PARAM.
  * This node will be a child of FuncDeclK.
  */
-TreeNode *newParamNode(ExpType);
+TreeNode *newParamNode(CompilerContext *, ExpType);
 
 /**
  * Create new node for simple-expression.
  */
-TreeNode *newSimpleExpNode();
+TreeNode *newSimpleExpNode(CompilerContext *);
 
 /**
  * Create new node for additive-expression.
  */
-TreeNode *newAddExpNode();
+TreeNode *newAddExpNode(CompilerContext *);
 
 /**
  * Create new node for NUM.
  */
-TreeNode *newConstExpNode(int val);
+TreeNode *newConstExpNode(CompilerContext *, int val);
+
+/**
+ * Create new node for an operator.
+ */
+TreeNode *newOpNode(CompilerContext *, TokenType op);
 
 /**
  * Check if given op is relop.
@@ -78,16 +108,101 @@ int is_mulop(TokenType);
 /**
  * Set node name.
  */
-void set_name(TreeNode *, char *);
+void set_name(TreeNode *, const char *);
+
+/* Function copyString makes a new copy of an
+ * existing string in the tree arena (arena.h)
+ */
+char *copyString(CompilerContext *, char *);
+
+/* Function currentLine returns the line on which
+ * the current token ends, as listed by traces and
+ * syntax errors
+ */
+int currentLine(CompilerContext *);
+
+/* Function tokenText returns the lexeme of the
+ * current token (at most MAXTOKENLEN characters),
+ * copied into ctx->tokenString. Only tracing and
+ * error messages need it.
+ */
+const char *tokenText(CompilerContext *);
+
+/* Function internLexeme returns the interned
+ * lexeme of the current token for the syntax tree
+ */
+const char *internLexeme(CompilerContext *);
 
-/* Function copyString allocates and makes a new
- * copy of an existing string
+/* Function lexemeValue returns the value of the
+ * current NUM token, as atoi() would
  */
-char *copyString(char *);
+int lexemeValue(CompilerContext *);
 
 /* procedure printTree prints a syntax tree to the
  * listing file using indentation to indicate subtrees
  */
-void printTree(TreeNode *);
+void printTree(CompilerContext *, TreeNode *);
+
+/* A token file (--emit-tokens=bin) holds the raw
+ * token stream of one source file, COMMENT tokens
+ * included, so that reruns can skip scanning. It is
+ * a TokenFileHeader followed by exactly ntokens
+ * TokenRecords, the last one ENDFILE. Fields are in
+ * the byte order of the writer and every part is
+ * aligned, so a file can be mapped and used in place.
+ */
+#define TOKMAGIC "CMTK"
+#define TOKVERSION 2
+#define TOKBYTEORDER 0x01020304u
+
+/* the low TOKKINDBITS bits of TokenRecord.lenKind
+ * are the TokenType, the others the lexeme length,
+ * which is at most TOKMAXLEN
+ */
+#define TOKKINDBITS 6
+#define TOKKINDMASK ((1u << TOKKINDBITS) - 1)
+#define TOKMAXLEN (UINT32_MAX >> TOKKINDBITS)
+
+typedef struct
+{
+  char magic[4];        /* TOKMAGIC */
+  uint16_t version;     /* TOKVERSION */
+  uint16_t recordSize;  /* sizeof(TokenRecord) */
+  uint32_t byteOrder;   /* TOKBYTEORDER as written */
+  uint32_t kindBits;    /* TOKKINDBITS */
+  uint64_t sourceLen;   /* bytes in the source file */
+  uint64_t sourceHash;  /* of the source bytes */
+  uint64_t ntokens;     /* records after the header */
+  uint64_t reserved[3];
+} TokenFileHeader;
+
+typedef struct
+{
+  uint32_t offset;  /* of the lexeme in the source */
+  uint32_t lenKind; /* length << TOKKINDBITS | TokenType */
+} TokenRecord;
+
+/* Function writeTokenFile writes the tokens of
+ * getToken(), up to ENDFILE, to the file at path.
+ * Returns FALSE if the file cannot be written.
+ */
+int writeTokenFile(CompilerContext *, const char *path);
+
+/* Function openTokenFile maps the token file at
+ * path into ctx->tokens, from which getToken() then
+ * takes the tokens of ctx->source. Returns FALSE,
+ * leaving ctx->tokens NULL, if there is no such
+ * file or it was not written from ctx->source.
+ */
+int openTokenFile(CompilerContext *, const char *path);
+
+/* Function tokenFileToken takes the next token of
+ * ctx->tokens into ctx->tok. COMMENT tokens are
+ * dropped if ctx->skipComments.
+ */
+TokenType tokenFileToken(CompilerContext *);
+
+/* Procedure closeTokenFile releases ctx->tokens */
+void closeTokenFile(CompilerContext *);
 
 #endif
@@ -0,0 +1,543 @@
+/****************************************************/
+/* File: cminus.y                                   */
+/* The C- Yacc/Bison specification file: the LALR(1) */
+/* parser of --parser=lalr, building the same trees */
+/* as the recursive-descent parser of parse.c       */
+/****************************************************/
+
+%code requires {
+#include "globals.h"
+
+/* a sibling list under construction */
+typedef struct
+{
+  TreeNode *node;  /* its first element */
+  TreeNode **last; /* the link holding its last element; NULL
+                      while that is node */
+} NodeList;
+
+/* an additive-expression or term */
+typedef struct
+{
+  TreeNode *node;  /* AddExpK or TermK, or the lone operand */
+  TreeNode **last; /* while it has an operator, the link
+                      holding its last operand; else NULL */
+} OpList;
+}
+
+%{
+#define YYPARSER /* distinguishes Yacc output from other code files */
+
+#include "globals.h"
+#include "util.h"
+#include "outbuf.h"
+#include "scan.h"
+#include "parse.h"
+
+/* nesting of the parser stack, far above the
+ * default of 10000
+ */
+#define YYMAXDEPTH 1000000
+%}
+
+%define api.pure full
+%define api.token.prefix {TOK_}
+%define parse.error custom
+%param {CompilerContext *ctx}
+%parse-param {TreeNode **tree}
+
+%code {
+static int yylex(YYSTYPE *lval, CompilerContext *ctx);
+static void yyerror(CompilerContext *ctx, TreeNode **tree, const char *message);
+
+/* Q becomes the sibling of the node held by link AT; returns
+ * the link holding Q
+ */
+static TreeNode **linkNode(TreeNode **at, TreeNode *q)
+{
+  (*at)->sibling = q;
+  return &(*at)->sibling;
+}
+
+/* append Q to list L */
+static void append(NodeList *l, TreeNode *q)
+{
+  if (q == NULL)
+    return;
+  if (l->node == NULL)
+    l->node = q;
+  else if (l->last == NULL)
+  {
+    l->node->sibling = q;
+    l->last = &l->node->sibling;
+  }
+  else
+    l->last = linkNode(l->last, q);
+}
+
+/* L OP OPERAND: the first operator opens a node of kind
+ * KIND around the lone operand of L
+ */
+static OpList chain(CompilerContext *ctx, OpList l, ExpKind kind,
+                    TreeNode *op, TreeNode *operand)
+{
+  if (l.last == NULL)
+  {
+    TreeNode *t = l.node;
+    l.node = kind == AddExpK ? newAddExpNode(ctx) : newExpNode(ctx, kind);
+    if (l.node == NULL || t == NULL)
+      return l;
+    l.node->offset = t->offset; /* of its first token */
+    l.node->child[0] = t;
+    l.last = &l.node->child[0];
+  }
+  if (op == NULL || operand == NULL)
+    return l;
+  l.last = linkNode(l.last, op);
+  l.last = linkNode(l.last, operand);
+  return l;
+}
+
+/* a node of kind KIND named NAME */
+static TreeNode *named(CompilerContext *ctx, StmtKind kind, const char *name, ExpType type)
+{
+  TreeNode *t = newStmtNode(ctx, kind);
+  if (t != NULL)
+  {
+    t->attr.name = name;
+    t->type = type;
+  }
+  return t;
+}
+
+/* compound statement of DECLS and STMTS */
+static TreeNode *compound(CompilerContext *ctx, NodeList decls, NodeList stmts)
+{
+  TreeNode *t = newStmtNode(ctx, CompoundK);
+  if (t != NULL)
+  {
+    t->child[0] = decls.node;
+    t->child[1] = stmts.node;
+  }
+  return t;
+}
+
+/* skip a { ... } block in error up to its matching }, as
+ * parse.c does; the parser has taken the {
+ */
+static void skipBlock(CompilerContext *ctx)
+{
+  int depth = 1;
+  do
+  {
+    ctx->token = getToken(ctx);
+    if (ctx->token == LBRACE)
+      depth++;
+    else if (ctx->token == RBRACE)
+      depth--;
+  } while (depth > 0 && ctx->token != ENDFILE);
+}
+}
+
+%union {
+  TreeNode *tree;
+  NodeList list;
+  OpList ops;
+  const char *name; /* of an ID, interned */
+  int val;          /* of a NUM */
+  ExpType type;
+  TokenType op;
+}
+
+%token IF ELSE INT RETURN VOID WHILE
+%token <name> ID
+%token <val> NUM
+%token ASSIGN SEMI COMMA
+%token LT LTEQ GT GTEQ EQ NOTEQ
+%token PLUS MINUS TIMES OVER
+%token LPAREN RPAREN LBRACE RBRACE LBRACKET RBRACKET
+%token ERROR /* ERROR, COMMENT and COMMENT_ERROR of the scanner */
+
+/* the dangling else binds to the nearest if */
+%precedence NOELSE
+%precedence ELSE
+
+%type <list> declaration_list local_declarations statement_list
+%type <list> param_list arg_list
+%type <ops> additive_expression term
+%type <tree> declaration var_declaration fun_declaration params param
+%type <tree> compound_stmt statement expression_stmt selection_stmt
+%type <tree> iteration_stmt return_stmt expression var simple_expression
+%type <tree> factor call args
+%type <type> type_specifier
+%type <op> relop addop mulop
+
+%% /* Grammar for C- */
+
+program     : declaration_list
+                 { *tree = $1.node; }
+            ;
+declaration_list : declaration_list declaration
+                 { $$ = $1; append(&$$, $2); *tree = $$.node; }
+            | declaration
+                 { $$.node = NULL; $$.last = NULL; append(&$$, $1); *tree = $$.node; }
+            ;
+/* the error rules skip the tokens that the recovery
+ * points of parse.c skip: up to the next declaration, past
+ * a ; or a } or a whole { ... } block, and in a compound
+ * statement past a ; or a block or up to its }. yyerrok
+ * then reports the next error at once, as parse.c does.
+ */
+declaration : var_declaration { $$ = $1; }
+            | fun_declaration { $$ = $1; }
+            | error SEMI { yyerrok; $$ = NULL; }
+            | error RBRACE { yyerrok; $$ = NULL; }
+            | error LBRACE { skipBlock(ctx); yyerrok; $$ = NULL; }
+            | error
+                 { /* a declaration follows at INT or VOID;
+                    * any other token is skipped */
+                   if (yychar == TOK_INT || yychar == TOK_VOID)
+                     yyerrok;
+                   $$ = NULL;
+                 }
+            ;
+var_declaration : type_specifier ID SEMI
+                 { $$ = named(ctx, VarDeclK, $2, $1);
+                   if ($$ != NULL)
+                     $$->child[0] = newTypeNode(ctx, $1);
+                 }
+            | type_specifier ID LBRACKET NUM RBRACKET SEMI
+                 { $$ = named(ctx, ArrayDeclK, $2, $1);
+                   if ($$ != NULL)
+                   { $$->arr_size = $4;
+                     $$->child[0] = newTypeNode(ctx, IntegerArray);
+                     $$->child[1] = newArrSizeNode(ctx, $4);
+                   }
+                 }
+            ;
+type_specifier : INT { $$ = Integer; }
+            | VOID { $$ = Void; }
+            ;
+fun_declaration : type_specifier ID LPAREN params RPAREN compound_stmt
+                 { $$ = named(ctx, FuncDeclK, $2, $1);
+                   if ($$ != NULL)
+                   { $$->child[0] = newTypeNode(ctx, $1);
+                     $$->child[1] = $4;
+                     $$->child[2] = $6;
+                   }
+                 }
+            ;
+params      : param_list
+                 { $$ = newExpNode(ctx, ParamListK);
+                   if ($$ != NULL)
+                     $$->child[0] = $1.node;
+                 }
+            | VOID
+                 { $$ = newExpNode(ctx, ParamListK);
+                   if ($$ != NULL)
+                     $$->child[0] = newTypeNode(ctx, Void);
+                 }
+            ;
+param_list  : param_list COMMA param
+                 { $$ = $1; append(&$$, $3); }
+            | param
+                 { $$.node = NULL; $$.last = NULL; append(&$$, $1); }
+            ;
+param       : INT ID
+                 { $$ = newExpNode(ctx, ParamK);
+                   if ($$ != NULL)
+                   { $$->attr.name = $2;
+                     $$->type = Integer;
+                     $$->child[0] = newTypeNode(ctx, Integer);
+                   }
+                 }
+            | INT ID LBRACKET RBRACKET
+                 { $$ = newExpNode(ctx, ParamK);
+                   if ($$ != NULL)
+                   { $$->attr.name = $2;
+                     $$->type = IntegerArray;
+                     $$->child[0] = newTypeNode(ctx, IntegerArray);
+                   }
+                 }
+            ;
+compound_stmt : LBRACE local_declarations statement_list RBRACE
+                 { $$ = compound(ctx, $2, $3); }
+            | LBRACE local_declarations statement_list error RBRACE
+                 { yyerrok; $$ = compound(ctx, $2, $3); }
+            | LBRACE local_declarations type_specifier error RBRACE
+                 { NodeList none = {NULL, NULL};
+                   yyerrok;
+                   $$ = compound(ctx, $2, none);
+                 }
+            ;
+local_declarations : local_declarations var_declaration
+                 { $$ = $1; append(&$$, $2); }
+            | local_declarations type_specifier error SEMI
+                 { yyerrok; $$ = $1; }
+            | local_declarations type_specifier error LBRACE
+                 { skipBlock(ctx); yyerrok; $$ = $1; }
+            | %empty
+                 { $$.node = NULL; $$.last = NULL; }
+            ;
+statement_list : statement_list statement
+                 { $$ = $1; append(&$$, $2); }
+            | statement_list error SEMI
+                 { yyerrok; $$ = $1; }
+            | statement_list error LBRACE
+                 { skipBlock(ctx); yyerrok; $$ = $1; }
+            | %empty
+                 { $$.node = NULL; $$.last = NULL; }
+            ;
+statement   : expression_stmt { $$ = $1; }
+            | compound_stmt { $$ = $1; }
+            | selection_stmt { $$ = $1; }
+            | iteration_stmt { $$ = $1; }
+            | return_stmt { $$ = $1; }
+            ;
+expression_stmt : expression SEMI
+                 { $$ = $1; }
+            | SEMI { $$ = NULL; }
+            ;
+selection_stmt : IF LPAREN expression RPAREN statement %prec NOELSE
+                 { $$ = newStmtNode(ctx, IfK);
+                   if ($$ != NULL)
+                   { $$->child[0] = $3;
+                     $$->child[1] = $5;
+                   }
+                 }
+            | IF LPAREN expression RPAREN statement ELSE statement
+                 { TreeNode *q = newStmtNode(ctx, ElseK);
+                   $$ = newStmtNode(ctx, IfK);
+                   if ($$ != NULL)
+                   { $$->child[0] = $3;
+                     $$->child[1] = $5;
+                     $$->sibling = q;
+                   }
+                   if (q != NULL)
+                     q->child[0] = $7;
+                 }
+            ;
+iteration_stmt : WHILE LPAREN expression RPAREN statement
+                 { $$ = newStmtNode(ctx, WhileK);
+                   if ($$ != NULL)
+                   { $$->child[0] = $3;
+                     $$->child[1] = $5;
+                   }
+                 }
+            ;
+return_stmt : RETURN SEMI
+                 { $$ = newStmtNode(ctx, ReturnK);
+                   if ($$ != NULL)
+                     $$->child[0] = newTypeNode(ctx, Void);
+                 }
+            | RETURN expression SEMI
+                 { $$ = newStmtNode(ctx, ReturnK);
+                   if ($$ != NULL)
+                     $$->child[0] = $2;
+                 }
+            ;
+expression  : var ASSIGN expression
+                 { $$ = newStmtNode(ctx, AssignK);
+                   if ($$ != NULL)
+                   { $$->child[0] = $1;
+                     $$->child[1] = $3;
+                   }
+                 }
+            | simple_expression { $$ = $1; }
+            ;
+var         : ID
+                 { $$ = newExpNode(ctx, VarCallK);
+                   if ($$ != NULL)
+                     $$->attr.name = $1;
+                 }
+            | ID LBRACKET expression RBRACKET
+                 { $$ = newExpNode(ctx, ArrayCallK);
+                   if ($$ != NULL)
+                   { $$->attr.name = $1;
+                     $$->child[0] = newExpNode(ctx, ArrayIndexK);
+                     if ($$->child[0] != NULL)
+                       $$->child[0]->child[0] = $3;
+                   }
+                 }
+            ;
+simple_expression : additive_expression relop additive_expression
+                 { $$ = newSimpleExpNode(ctx);
+                   if ($$ != NULL)
+                   { if ($1.node != NULL)
+                       $$->offset = $1.node->offset; /* of its first token */
+                     $$->child[0] = $1.node;
+                     $$->child[1] = newOpNode(ctx, $2);
+                     $$->child[2] = $3.node;
+                   }
+                 }
+            | additive_expression { $$ = $1.node; }
+            ;
+relop       : LT { $$ = LT; }
+            | LTEQ { $$ = LTEQ; }
+            | GT { $$ = GT; }
+            | GTEQ { $$ = GTEQ; }
+            | EQ { $$ = EQ; }
+            | NOTEQ { $$ = NOTEQ; }
+            ;
+additive_expression : additive_expression addop term
+                 { $$ = chain(ctx, $1, AddExpK, newOpNode(ctx, $2), $3.node); }
+            | term
+                 { $$.node = $1.node; $$.last = NULL; }
+            ;
+addop       : PLUS { $$ = PLUS; }
+            | MINUS { $$ = MINUS; }
+            ;
+term        : term mulop factor
+                 { $$ = chain(ctx, $1, TermK, newOpNode(ctx, $2), $3); }
+            | factor
+                 { $$.node = $1; $$.last = NULL; }
+            ;
+mulop       : TIMES { $$ = TIMES; }
+            | OVER { $$ = OVER; }
+            ;
+factor      : LPAREN expression RPAREN { $$ = $2; }
+            | var { $$ = $1; }
+            | call { $$ = $1; }
+            | NUM { $$ = newConstExpNode(ctx, $1); }
+            ;
+call        : ID LPAREN args RPAREN
+                 { $$ = newExpNode(ctx, FuncCallK);
+                   if ($$ != NULL)
+                   { $$->attr.name = $1;
+                     $$->child[0] = $3;
+                   }
+                 }
+            ;
+args        : arg_list
+                 { $$ = newExpNode(ctx, ArgK);
+                   if ($$ != NULL)
+                     $$->child[0] = $1.node;
+                 }
+            | %empty { $$ = NULL; }
+            ;
+arg_list    : arg_list COMMA expression
+                 { $$ = $1; append(&$$, $3); }
+            | expression
+                 { $$.node = NULL; $$.last = NULL; append(&$$, $1); }
+            ;
+
+%%
+
+/* the parser's token for each token of the scanner */
+static const int tokenCode[RBRACKET + 1] = {
+    [ENDFILE] = TOK_YYEOF, [ERROR] = TOK_ERROR,
+    [COMMENT] = TOK_ERROR, [COMMENT_ERROR] = TOK_ERROR,
+    [IF] = TOK_IF, [ELSE] = TOK_ELSE, [INT] = TOK_INT,
+    [RETURN] = TOK_RETURN, [VOID] = TOK_VOID, [WHILE] = TOK_WHILE,
+    [ID] = TOK_ID, [NUM] = TOK_NUM,
+    [ASSIGN] = TOK_ASSIGN, [SEMI] = TOK_SEMI, [COMMA] = TOK_COMMA,
+    [LT] = TOK_LT, [LTEQ] = TOK_LTEQ, [GT] = TOK_GT,
+    [GTEQ] = TOK_GTEQ, [EQ] = TOK_EQ, [NOTEQ] = TOK_NOTEQ,
+    [PLUS] = TOK_PLUS, [MINUS] = TOK_MINUS, [TIMES] = TOK_TIMES, [OVER] = TOK_OVER,
+    [LPAREN] = TOK_LPAREN, [RPAREN] = TOK_RPAREN, [LBRACE] = TOK_LBRACE,
+    [RBRACE] = TOK_RBRACE, [LBRACKET] = TOK_LBRACKET, [RBRACKET] = TOK_RBRACKET};
+
+/* has parsing to stop? */
+static int stopped(CompilerContext *ctx)
+{
+  return ctx->maxErrors > 0 && ctx->syntaxErrors >= ctx->maxErrors;
+}
+
+/* the names and values of ID and NUM are taken here:
+ * the parser may read one token ahead before it uses them
+ */
+static int yylex(YYSTYPE *lval, CompilerContext *ctx)
+{
+  if (stopped(ctx))
+    return TOK_YYEOF; /* ends error recovery */
+  ctx->token = getToken(ctx);
+  if (ctx->token == ID)
+    lval->name = internLexeme(ctx);
+  else if (ctx->token == NUM)
+    lval->val = lexemeValue(ctx);
+  return tokenCode[ctx->token];
+}
+
+/* the scanner's token for symbol SYM of the parser */
+static TokenType tokenOf(yysymbol_kind_t sym)
+{
+  int t;
+  for (t = ENDFILE; t <= RBRACKET; t++)
+    if (YYTRANSLATE(tokenCode[t]) == sym)
+      return (TokenType)t;
+  return ERROR;
+}
+
+/* count a syntax error and start its report as parse.c
+ * does; FALSE if it is not to be reported
+ */
+static int errorHeader(CompilerContext *ctx)
+{
+  ctx->Error = TRUE;
+  if (stopped(ctx))
+    return FALSE;
+  ctx->syntaxErrors++;
+  if (ctx->listing == NULL)
+    return FALSE;
+  outPrintf(ctx->listing, "\n");
+  outPrintf(ctx->listing, ">>> Syntax error at line %d: \n    ", currentLine(ctx));
+  return TRUE;
+}
+
+/* a syntax error, reported like fail() in parse.c: the
+ * tokens the parser could take, then the actual token and
+ * the first expected one. As in parse.c the end of the
+ * file is not listed where a declaration may follow.
+ */
+static int yyreport_syntax_error(const yypcontext_t *yyctx, CompilerContext *ctx,
+                                 TreeNode **tree)
+{
+  yysymbol_kind_t expected[YYNTOKENS];
+  int n = yypcontext_expected_tokens(yyctx, expected, YYNTOKENS), i;
+  (void)tree;
+  if (n > 1 && expected[0] == YYSYMBOL_YYEOF)
+    memmove(expected, expected + 1, --n * sizeof(expected[0]));
+  if (!errorHeader(ctx))
+    return 0;
+  outPuts(ctx->listing, "yyparse() failed.");
+  if (n > 0)
+  {
+    outPuts(ctx->listing, " (");
+    for (i = 0; i < n; i++)
+    {
+      outPuts(ctx->listing, i > 0 ? " | " : " ");
+      outPuts(ctx->listing, yysymbol_name(expected[i]));
+    }
+    outPuts(ctx->listing, " )");
+  }
+  outPuts(ctx->listing, "\n");
+  outPrintf(ctx->listing, "    actual   : ");
+  printToken(ctx, ctx->token, tokenText(ctx));
+  if (n > 0)
+  {
+    outPrintf(ctx->listing, "    expected : ");
+    printToken(ctx, tokenOf(expected[0]), "");
+  }
+  return 0;
+}
+
+/* any other error of the parser, e.g. its stack overflowing */
+static void yyerror(CompilerContext *ctx, TreeNode **tree, const char *message)
+{
+  (void)tree;
+  if (!errorHeader(ctx))
+    return;
+  outPuts(ctx->listing, "yyparse() failed. ");
+  outPuts(ctx->listing, message);
+  outPuts(ctx->listing, "\n");
+}
+
+TreeNode *lalrParse(CompilerContext *ctx)
+{
+  TreeNode *t = NULL;
+  ctx->syntaxErrors = 0;
+  /* comments are dropped by the scanner */
+  ctx->skipComments = TRUE;
+  yyparse(ctx, &t);
+  return t;
+}